@@ -14,13 +14,14 @@
 #define CHUNK_WIDTH 10
 #define CHUNK_HEIGHT 10
 
-#define MAP_WIDTH 3 * CHUNK_WIDTH
-#define MAP_HEIGHT 3 * CHUNK_HEIGHT
-
 #define SQUARE_SIZE 30
 
+#define CHUNK_PX_WIDTH (CHUNK_WIDTH * SQUARE_SIZE)
+#define CHUNK_PX_HEIGHT (CHUNK_HEIGHT * SQUARE_SIZE)
+
 #define BORDER_SIZE 4.5
 
+// Default window size, the window is resizable
 #define WIN_W (int)(CHUNK_WIDTH + BORDER_SIZE*2) * SQUARE_SIZE
 #define WIN_H (int)(CHUNK_HEIGHT + BORDER_SIZE*2) * SQUARE_SIZE
 
@@ -28,6 +29,15 @@
 
 #define MINES CHUNK_WIDTH*CHUNK_HEIGHT/5
 
+// Most 0 areas a chunk can hold, with 8-connected areas they are at least 2 tiles apart
+#define MAX_ZERO_COMPONENTS (((CHUNK_HEIGHT + 1) / 2) * ((CHUNK_WIDTH + 1) / 2))
+
+#define CHUNK_WORKERS 2 // Threads preparing the chunks around the grid, 0 to prepare them on the update thread
+#define DATA_SAVE_VERSION 1 // First byte of saves/data.msav, the older saves start with the score
+#define DATA_SAVE_SIZE (sizeof(uint8_t) + sizeof(uint32_t) + sizeof(bool) + 4*sizeof(int) + sizeof(uint64_t)) // Size of saves/data.msav
+#define LEGACY_DATA_SIZE (sizeof(uint32_t) + sizeof(bool) + 4*sizeof(int)) // Size of the saves/data.msav of the 3x3 grid, without seed
+#define CHUNK_CACHE_RINGS 4 // Rings of chunks around the grid kept in memory after they left it, 0 to save and load them directly
+
 #define SAVE_ANIM_FRAMES 100
 
 #define MENU_ALPHA_STEP 10
@@ -39,6 +49,13 @@ enum _state {
     FLAGGED
 };
 
+enum _planes {
+    P_MINE = 0,
+    P_REVEALED,
+    P_FLAGGED,
+    PLANE_COUNT
+};
+
 enum _textures {
     T_HIDDEN = 0,
     T_MINE,
@@ -48,8 +65,69 @@ enum _textures {
     T_BACKGROUND,
 };
 
+/**
+ * Bitplanes of a chunk, one 64-bit word per chunk row for each plane
+ * \note Bit `col` of `bits[plane][row]` is the cell (`row`, `col`) of the chunk, a chunk row
+ * plus its two halo bits must fit in a word (CHUNK_WIDTH <= 62)
+ */
+typedef struct _ChunkPlanes {
+    uint64_t bits[PLANE_COUNT][CHUNK_HEIGHT];
+} ChunkPlanes;
+
+/**
+ * Chunk buffer, the grid is a view over the loaded chunks
+ */
+typedef struct _Chunk {
+    uint8_t tiles[CHUNK_HEIGHT][CHUNK_WIDTH]; // Tiles of the chunk, saved as is
+    ChunkPlanes planes; // Bitplanes of the chunk, kept in sync with the tiles
+    uint8_t flag_counts[CHUNK_HEIGHT][CHUNK_WIDTH]; // Flagged tiles around each tile, in the grid
+    uint8_t zero_labels[CHUNK_HEIGHT][CHUNK_WIDTH]; // 0 area of each tile (from 1), 0 if the tile is not an unflagged 0
+    uint64_t zero_rows[MAX_ZERO_COMPONENTS][CHUNK_HEIGHT]; // Tiles of each 0 area, laid out as the bitplanes
+    uint8_t zero_count; // Number of 0 areas
+    bool zero_stale; // The 0 areas must be labelled again
+    bool dirty; // The render target of the chunk must be drawn again
+    bool stored; // The chunk can't be generated again from the seed (it has a save file or lost mines when generated)
+    bool unsaved; // The chunk changed since it was last saved
+} Chunk;
+
+/**
+ * Tiles of a chunk out of the grid to reveal when it is loaded, the continuation of a 0 area
+ */
+typedef struct _PendingReveal {
+    bool used; // The slot of the table holds an entry
+    bool unsaved; // The entry changed since its file was last written
+    int crow, ccol; // Chunk coordinates
+    uint64_t rows[CHUNK_HEIGHT]; // Tiles to reveal, laid out as the bitplanes
+} PendingReveal;
+
+typedef struct _WorkerPool WorkerPool;
+typedef struct _ChunkCache ChunkCache;
+typedef struct _TileRenderer TileRenderer;
+typedef struct _TextRenderer TextRenderer;
+
 typedef struct _Game {
-    uint8_t grid[MAP_HEIGHT][MAP_WIDTH]; // Minesweeper grid
+    Chunk *chunk_buffers; // Storage of the loaded chunks
+    uint32_t chunk_generation; // Incremented each time the chunk buffers are allocated again
+    Chunk **chunks; // Loaded chunks as laid out in the grid (row-major), the center chunk is at (radius, radius)
+    uint8_t *mine_pad; // Halo-padded mine plane used by gen_numbers
+    int pad_stride; // Stride of the halo-padded mine plane
+    int *zero_parent; // Union-find forest of the 0 areas of the loaded chunks, stitched across the seams
+    uint64_t *zero_area; // Tiles of the 0 area being revealed, CHUNK_HEIGHT rows per grid chunk
+    bool zero_stale; // Some chunks must be labelled again or the areas stitched again
+    int radius; // Number of chunks loaded on each side of the center chunk
+    int size; // Number of chunks on each side of the grid (2*radius + 1)
+    int map_w, map_h; // Grid size in tiles
+    int win_w, win_h; // Window size
+    PendingReveal *pending; // Pending reveals of the chunks out of the grid, open addressing table keyed by the chunk coordinates
+    int pending_count, pending_capacity; // Entries of the table and its size, a power of 2
+    TileRenderer *renderer; // Batch renderer of the tiles
+    TextRenderer *text; // Glyph atlas renderer of the text
+    WorkerPool *workers; // Chunk workers and their ready cache, NULL without workers
+    ChunkCache *cache; // Chunks kept in memory after they left the grid, NULL without cache
+    uint64_t seed; // World seed, the mines of a chunk only depend on it and the chunk coordinates
+    uint8_t saved_data[DATA_SAVE_SIZE]; // Content of saves/data.msav
+    bool data_saved; // saves/data.msav holds `saved_data`
+    uint64_t write_volume; // Bytes written to the save files since the start
     uint32_t score;
     uint32_t frame_count;
     uint32_t save_frame; // Frame count when saved
@@ -64,8 +142,20 @@ typedef struct _Game {
     int cx, cy; // Center chunk coordinates
 } Game;
 
-inline bool in_grid(int row, int col) {
-    return row >= 0 && row < MAP_HEIGHT && col >= 0 && col < MAP_WIDTH;
+inline bool in_grid(Game *game, int row, int col) {
+    return row >= 0 && row < game->map_h && col >= 0 && col < game->map_w;
+}
+
+inline Chunk *get_chunk(Game *game, int crow, int ccol) {
+    return game->chunks[crow * game->size + ccol];
+}
+
+inline uint8_t *get_tile(Game *game, int row, int col) {
+    return &get_chunk(game, row / CHUNK_HEIGHT, col / CHUNK_WIDTH)->tiles[row % CHUNK_HEIGHT][col % CHUNK_WIDTH];
+}
+
+inline uint8_t *get_flag_count(Game *game, int row, int col) {
+    return &get_chunk(game, row / CHUNK_HEIGHT, col / CHUNK_WIDTH)->flag_counts[row % CHUNK_HEIGHT][col % CHUNK_WIDTH];
 }
 
 // Tile functions
@@ -76,41 +166,131 @@ uint8_t get_tile_state(uint8_t tile);
 void store_tile_value(uint8_t *tile, uint8_t value);
 void store_tile_state(uint8_t *tile, uint8_t state);
 
+// Bitplane functions
+
+void build_chunk_planes(Chunk *chunk);
+void build_planes(Game *game);
+void set_tile_state(Game *game, int row, int col, uint8_t state);
+uint64_t padded_plane_row(Game *game, int plane, int row, int ccol);
+uint16_t neighbourhood_bits(Game *game, int plane, int row, int col);
+uint16_t neighbourhood_mask(Game *game, int row, int col);
+void count_flags_rect(Game *game, int row0, int col0, int row1, int col1);
+
+// Number functions
+
+bool use_number_kernel(const char *name);
+void fill_mine_pad(Game *game, int row0, int col0, int row1, int col1);
+void gen_numbers_rect(Game *game, int row0, int col0, int row1, int col1);
+void gen_numbers(Game *game);
+
+// Random functions
+
+uint64_t mix64(uint64_t z);
+uint64_t next_random(uint64_t *state);
+uint32_t random_below(uint64_t *state, uint32_t bound);
+uint64_t chunk_seed(uint64_t seed, int crow, int ccol);
+uint64_t gen_seed();
+
+// Zero area functions
+
+void build_zero_labels(Chunk *chunk);
+void update_zero_components(Game *game);
+void invalidate_zero_components(Game *game, int row0, int col0, int row1, int col1);
+int reveal_zero_area(Game *game, int row, int col);
+
+// Pending reveal functions
+
+void clear_pending_reveals(Game *game);
+void queue_pending_reveal(Game *game, int row, int col);
+void queue_area_edges(Game *game);
+void drain_pending_reveals(Game *game);
+void save_pending_reveals(Game *game);
+void load_pending_reveals(Game *game);
+
 // Game init functions
 
+void init_window(Game *game, int width, int height);
 void init_game(Game *game);
-void init_grid(uint8_t grid[MAP_HEIGHT][MAP_WIDTH]);
-void load_chunks_to_grid(uint8_t grid[MAP_HEIGHT][MAP_WIDTH], uint8_t chunks[3][3][CHUNK_HEIGHT][CHUNK_WIDTH]);
-void gen_numbers(uint8_t grid[MAP_HEIGHT][MAP_WIDTH]);
-void gen_chunk(uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH]);
-void gen_mines(uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH]);
-
-void create_tiles(Game *game);
+int calc_window_radius(int width, int height);
+void alloc_chunks(Game *game, int radius);
+void free_chunks(Game *game);
+void init_chunks(Game *game);
+void gen_chunk(uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH], uint64_t seed, int crow, int ccol, const uint64_t safe[CHUNK_HEIGHT]);
+void gen_mines(uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH], uint64_t *state, const uint64_t safe[CHUNK_HEIGHT]);
+bool get_safe_tiles(int crow, int ccol, int row, int col, uint64_t safe[CHUNK_HEIGHT]);
+
+uint8_t tile_texture(Game *game, int row, int col);
 void start_game(Game *game, int row, int col);
 
 // Game update functions
 
 void reveal_tile(Game *game, int row, int col);
-void reveal_bombs(Game *game, int row, int col);
+int reveal_area(Game *game, int row, int col);
+void reveal_neighbours(Game *game, int row, int col);
+void reveal_bombs(Game *game);
 void reveal_number(Game *game, int row, int col);
 
 // Viewport/chunk functions
 
+void resize_window(Game *game, int width, int height);
 void calc_current_centered_chunk(Game *game, int *x, int *y);
 void shift_game_chunks(Game *game, int dx, int dy);
-void check_mine_valid(Game *game, uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH], int row, int col, int crow, int ccol);
+bool check_mine_valid(Game *game, uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH], int row, int col, int crow, int ccol);
 void add_chunk_to_game(Game *game, int row, int col, int crow, int ccol);
 void post_process_shift_chunks(Game *game, int dx, int dy);
 
+// Worker functions
+
+void start_workers(Game *game, int count);
+void stop_workers(Game *game);
+void prefetch_chunks(Game *game);
+bool take_ready_chunk(Game *game, int crow, int ccol, uint8_t tiles[CHUNK_HEIGHT][CHUNK_WIDTH], bool *stored);
+void queue_chunk_save(Game *game, uint8_t tiles[CHUNK_HEIGHT][CHUNK_WIDTH], int crow, int ccol);
+void flush_chunk_writes(Game *game);
+
+// Chunk cache functions
+
+void init_chunk_cache(Game *game, int rings);
+void free_chunk_cache(Game *game);
+bool chunk_cached(Game *game, int crow, int ccol);
+void cache_chunk(Game *game, uint8_t tiles[CHUNK_HEIGHT][CHUNK_WIDTH], int crow, int ccol);
+bool read_cached_chunk(Game *game, uint8_t tiles[CHUNK_HEIGHT][CHUNK_WIDTH], int crow, int ccol);
+void write_back_chunks(Game *game);
+void clear_chunk_cache(Game *game);
+void get_chunk_cache_stats(Game *game, uint32_t *hits, uint32_t *misses);
+
+// Render functions
+
+void init_tile_renderer(Game *game, SSGE_Tilemap *atlas);
+void free_tile_renderer(Game *game);
+void invalidate_render_rect(Game *game, int row0, int col0, int row1, int col1);
+void reset_render_targets(Game *game, bool device_lost);
+void draw_tiles(Game *game);
+
+// Text functions
+
+void init_text_renderer(Game *game, char *filename, int size);
+void free_text_renderer(Game *game);
+void draw_text(Game *game, char *text, int x, int y, SSGE_Color color, SSGE_Anchor anchor);
+
+// Region functions
+
+void open_regions();
+void close_regions();
+void save_chunk(uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH], int row, int col);
+bool load_chunk(uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH], int row, int col);
+void delete_regions();
+void migrate_chunk_files();
+
 // Save/load functions
 
 void save_data(Game *game);
 void load_data(Game *game);
-void save_chunk(uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH], int row, int col);
+bool chunk_needs_save(Game *game, int crow, int ccol);
 void save_chunks(Game *game);
-void load_chunk(uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH], int row, int col);
 void load_chunks(Game *game, int row, int col);
-void delete_save();
+void delete_save(Game *game);
+void print_save_stats(Game *game);
 
 inline void save_game(Game *game) {
     save_data(game);
@@ -0,0 +1,139 @@
+#include "game.h"
+
+/**
+ * Builds the bitplanes of a chunk from its tiles
+ * \param chunk The chunk to build the bitplanes for
+ */
+void build_chunk_planes(Chunk *chunk) {
+    ChunkPlanes *planes = &chunk->planes;
+    for (int row = 0; row < CHUNK_HEIGHT; row++) {
+        uint64_t mine = 0, revealed = 0, flagged = 0;
+        for (int col = 0; col < CHUNK_WIDTH; col++) {
+            uint8_t value, state;
+            get_tile_info(chunk->tiles[row][col], &value, &state);
+            mine |= (uint64_t)(value == 9) << col;
+            revealed |= (uint64_t)(state == REVEALED) << col;
+            flagged |= (uint64_t)(state == FLAGGED) << col;
+        }
+        planes->bits[P_MINE][row] = mine;
+        planes->bits[P_REVEALED][row] = revealed;
+        planes->bits[P_FLAGGED][row] = flagged;
+    }
+}
+
+/**
+ * Builds the bitplanes of all the loaded chunks from their tiles
+ * \param game The game to build the bitplanes for
+ */
+void build_planes(Game *game) {
+    for (int i = 0; i < game->size * game->size; i++) {
+        build_chunk_planes(game->chunks[i]);
+    }
+}
+
+/**
+ * Stores a state in a tile of the grid and updates the bitplanes
+ * \param game The game to store the state in
+ * \param row The row of the tile
+ * \param col The column of the tile
+ * \param state The state to store
+ */
+void set_tile_state(Game *game, int row, int col, uint8_t state) {
+    store_tile_state(get_tile(game, row, col), state);
+    Chunk *chunk = get_chunk(game, row / CHUNK_HEIGHT, col / CHUNK_WIDTH);
+    chunk->dirty = chunk->unsaved = true;
+    ChunkPlanes *planes = &chunk->planes;
+    uint64_t *revealed = &planes->bits[P_REVEALED][row % CHUNK_HEIGHT];
+    uint64_t *flagged = &planes->bits[P_FLAGGED][row % CHUNK_HEIGHT];
+    uint64_t bit = 1ULL << (col % CHUNK_WIDTH);
+    *revealed = state == REVEALED ? *revealed | bit : *revealed & ~bit;
+    if (((*flagged & bit) != 0) != (state == FLAGGED)) {
+        // Flags split the 0 areas
+        invalidate_zero_components(game, row, col, row + 1, col + 1);
+        for (int i = row - 1; i <= row + 1; i++) {
+            for (int j = col - 1; j <= col + 1; j++) {
+                if ((i != row || j != col) && in_grid(game, i, j)) {
+                    *get_flag_count(game, i, j) += state == FLAGGED ? 1 : -1;
+                }
+            }
+        }
+    }
+    *flagged = state == FLAGGED ? *flagged | bit : *flagged & ~bit;
+}
+
+/**
+ * Gets a chunk row of a bitplane padded with one halo bit on each side
+ * \param game The game to get the row from
+ * \param plane The plane to get the row from
+ * \param row The row in the game grid
+ * \param ccol The column of the chunk in the game grid
+ * \return The chunk row shifted left by one, bit 0 and bit CHUNK_WIDTH+1 hold the last column of
+ * the left chunk and the first column of the right chunk, 0 outside of the grid
+ */
+uint64_t padded_plane_row(Game *game, int plane, int row, int ccol) {
+    if (row < 0 || row >= game->map_h) {
+        return 0;
+    }
+    Chunk **chunks = &game->chunks[row / CHUNK_HEIGHT * game->size + ccol];
+    row %= CHUNK_HEIGHT;
+    uint64_t word = chunks[0]->planes.bits[plane][row] << 1;
+    if (ccol > 0) {
+        word |= (chunks[-1]->planes.bits[plane][row] >> (CHUNK_WIDTH - 1)) & 1;
+    }
+    if (ccol < game->size - 1) {
+        word |= (chunks[1]->planes.bits[plane][row] & 1) << (CHUNK_WIDTH + 1);
+    }
+    return word;
+}
+
+/**
+ * Gets the 3x3 neighbourhood of a tile in a bitplane
+ * \param game The game to get the neighbourhood from
+ * \param plane The plane to get the neighbourhood from
+ * \param row The row of the tile
+ * \param col The column of the tile
+ * \return A 9-bit mask, bit `(i+1)*3 + (j+1)` is the tile (`row+i`, `col+j`), 0 outside of the grid
+ */
+uint16_t neighbourhood_bits(Game *game, int plane, int row, int col) {
+    int ccol = col / CHUNK_WIDTH;
+    col %= CHUNK_WIDTH;
+    uint16_t bits = 0;
+    for (int i = 0; i < 3; i++) {
+        bits |= (uint16_t)(((padded_plane_row(game, plane, row + i - 1, ccol) >> col) & 0b111) << (i*3));
+    }
+    return bits;
+}
+
+/**
+ * Gets the mask of the neighbourhood tiles that are in the grid
+ * \param game The game to get the mask for
+ * \param row The row of the tile
+ * \param col The column of the tile
+ * \return A 9-bit mask laid out as in `neighbourhood_bits`
+ */
+uint16_t neighbourhood_mask(Game *game, int row, int col) {
+    uint16_t mask = 0b111111111;
+    if (row == 0) mask &= 0b111111000;
+    if (row == game->map_h - 1) mask &= 0b000111111;
+    if (col == 0) mask &= 0b110110110;
+    if (col == game->map_w - 1) mask &= 0b011011011;
+    return mask;
+}
+
+/**
+ * Counts the flagged tiles around the tiles of an area of the grid
+ * \param game The game to count the flags in
+ * \param row0 The first row of the area
+ * \param col0 The first column of the area
+ * \param row1 The row after the last row of the area
+ * \param col1 The column after the last column of the area
+ * \note The counts are then kept up to date by `set_tile_state`
+ */
+void count_flags_rect(Game *game, int row0, int col0, int row1, int col1) {
+    for (int row = row0; row < row1; row++) {
+        for (int col = col0; col < col1; col++) {
+            // The tile itself is bit 4
+            *get_flag_count(game, row, col) = (uint8_t)__builtin_popcount(neighbourhood_bits(game, P_FLAGGED, row, col) & ~0b000010000);
+        }
+    }
+}
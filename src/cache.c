@@ -0,0 +1,209 @@
+#include "game.h"
+
+/**
+ * Chunk kept in memory after it left the grid
+ */
+typedef struct _CachedChunk {
+    bool used;
+    bool dirty; // Newer than the save file of the chunk, written back when evicted
+    int crow, ccol; // Chunk coordinates
+    uint32_t last_use; // Tick of the last access, the lowest one is evicted first
+    uint8_t tiles[CHUNK_HEIGHT][CHUNK_WIDTH];
+} CachedChunk;
+
+struct _ChunkCache {
+    CachedChunk *entries;
+    int capacity; // Number of chunks the cache can hold
+    int rings; // Rings of chunks around the grid the cache can hold
+    uint32_t tick;
+    uint32_t hits, misses;
+};
+
+/**
+ * Grows the cache to hold the rings of chunks around the current grid, the cached chunks are kept
+ * \param cache The cache to grow
+ * \param size The number of chunks on each side of the grid
+ * \note The cache does not shrink with the grid
+ */
+static void fit_chunk_cache(ChunkCache *cache, int size) {
+    int outer = size + 2 * cache->rings;
+    int capacity = outer * outer - size * size;
+    if (capacity <= cache->capacity) {
+        return;
+    }
+    cache->entries = (CachedChunk *)realloc(cache->entries, capacity * sizeof(CachedChunk));
+    if (cache->entries == NULL) {
+        fprintf(stderr, "Error allocating the chunk cache\n");
+        exit(1);
+    }
+    memset(&cache->entries[cache->capacity], 0, (capacity - cache->capacity) * sizeof(CachedChunk));
+    cache->capacity = capacity;
+}
+
+/**
+ * Creates the chunk cache
+ * \param game The game to create the cache for, its grid must be allocated
+ * \param rings The number of rings of chunks around the grid the cache can hold, 0 saves and loads
+ * the chunks directly
+ */
+void init_chunk_cache(Game *game, int rings) {
+    game->cache = NULL;
+    if (rings <= 0) {
+        return;
+    }
+    ChunkCache *cache = (ChunkCache *)calloc(1, sizeof(ChunkCache));
+    if (cache == NULL) {
+        fprintf(stderr, "Error allocating the chunk cache\n");
+        exit(1);
+    }
+    cache->rings = rings;
+    fit_chunk_cache(cache, game->size);
+    game->cache = cache;
+}
+
+/**
+ * Writes back the chunk cache and destroys it
+ * \param game The game to destroy the cache of
+ */
+void free_chunk_cache(Game *game) {
+    ChunkCache *cache = game->cache;
+    if (cache == NULL) {
+        return;
+    }
+    write_back_chunks(game);
+    free(cache->entries);
+    free(cache);
+    game->cache = NULL;
+}
+
+/**
+ * Finds a chunk in the cache
+ * \param cache The cache to search
+ * \param crow The row of the chunk
+ * \param ccol The column of the chunk
+ * \return The entry of the chunk, NULL if it is not cached
+ */
+static CachedChunk *find_cached(ChunkCache *cache, int crow, int ccol) {
+    for (int i = 0; i < cache->capacity; i++) {
+        CachedChunk *entry = &cache->entries[i];
+        if (entry->used && entry->crow == crow && entry->ccol == ccol) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Checks if a chunk is in the cache
+ * \param game The game the cache is in
+ * \param crow The row of the chunk
+ * \param ccol The column of the chunk
+ */
+bool chunk_cached(Game *game, int crow, int ccol) {
+    return game->cache != NULL && find_cached(game->cache, crow, ccol) != NULL;
+}
+
+/**
+ * Stores a chunk in the cache, evicts the least recently used chunk if the cache is full
+ * \param game The game the cache is in
+ * \param tiles The tiles of the chunk
+ * \param crow The row of the chunk
+ * \param ccol The column of the chunk
+ * \note The chunk is saved right away without a cache. An evicted chunk is written back if it
+ * changed since it was read
+ */
+void cache_chunk(Game *game, uint8_t tiles[CHUNK_HEIGHT][CHUNK_WIDTH], int crow, int ccol) {
+    ChunkCache *cache = game->cache;
+    if (cache == NULL) {
+        queue_chunk_save(game, tiles, crow, ccol);
+        return;
+    }
+    fit_chunk_cache(cache, game->size);
+    CachedChunk *entry = find_cached(cache, crow, ccol);
+    if (entry == NULL) {
+        entry = &cache->entries[0];
+        for (int i = 0; i < cache->capacity && entry->used; i++) {
+            if (!cache->entries[i].used || cache->entries[i].last_use < entry->last_use) {
+                entry = &cache->entries[i];
+            }
+        }
+        if (entry->used && entry->dirty) {
+            queue_chunk_save(game, entry->tiles, entry->crow, entry->ccol);
+        }
+        entry->used = true;
+        entry->crow = crow;
+        entry->ccol = ccol;
+        entry->dirty = true;
+    } else if (!entry->dirty) {
+        entry->dirty = memcmp(entry->tiles, tiles, sizeof(entry->tiles)) != 0;
+    }
+    memcpy(entry->tiles, tiles, sizeof(entry->tiles));
+    entry->last_use = ++cache->tick;
+}
+
+/**
+ * Reads a chunk from the cache
+ * \param game The game the cache is in
+ * \param tiles The tiles to copy the chunk in
+ * \param crow The row of the chunk
+ * \param ccol The column of the chunk
+ * \return True if the chunk was cached
+ */
+bool read_cached_chunk(Game *game, uint8_t tiles[CHUNK_HEIGHT][CHUNK_WIDTH], int crow, int ccol) {
+    ChunkCache *cache = game->cache;
+    if (cache == NULL) {
+        return false;
+    }
+    CachedChunk *entry = find_cached(cache, crow, ccol);
+    if (entry == NULL) {
+        cache->misses++;
+        return false;
+    }
+    cache->hits++;
+    memcpy(tiles, entry->tiles, sizeof(entry->tiles));
+    entry->last_use = ++cache->tick;
+    return true;
+}
+
+/**
+ * Writes the changed chunks of the cache to their save files
+ * \param game The game the cache is in
+ * \note The chunks stay cached, the files are written by the workers
+ */
+void write_back_chunks(Game *game) {
+    ChunkCache *cache = game->cache;
+    if (cache == NULL) {
+        return;
+    }
+    for (int i = 0; i < cache->capacity; i++) {
+        CachedChunk *entry = &cache->entries[i];
+        if (entry->used && entry->dirty) {
+            queue_chunk_save(game, entry->tiles, entry->crow, entry->ccol);
+            entry->dirty = false;
+        }
+    }
+}
+
+/**
+ * Drops every chunk of the cache without writing them back
+ * \param game The game the cache is in
+ */
+void clear_chunk_cache(Game *game) {
+    ChunkCache *cache = game->cache;
+    if (cache == NULL) {
+        return;
+    }
+    memset(cache->entries, 0, cache->capacity * sizeof(CachedChunk));
+    cache->tick = 0;
+}
+
+/**
+ * Gets the hit and miss counters of the chunk cache
+ * \param game The game the cache is in
+ * \param hits The variable to store the number of chunks read from the cache in
+ * \param misses The variable to store the number of chunks that were not cached in
+ */
+void get_chunk_cache_stats(Game *game, uint32_t *hits, uint32_t *misses) {
+    *hits = game->cache != NULL ? game->cache->hits : 0;
+    *misses = game->cache != NULL ? game->cache->misses : 0;
+}
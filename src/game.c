@@ -45,6 +45,34 @@ void store_tile_state(uint8_t *tile, uint8_t state) {
     *tile = (uint8_t)((*tile & 0b00001111) | (state << 6));
 }
 
+/**
+ * Initializes the window related fields of the game structure
+ * \param game The game to initialize
+ * \param width The width of the window
+ * \param height The height of the window
+ * \note This function must be called once before `init_game`
+ */
+void init_window(Game *game, int width, int height) {
+    game->chunk_buffers = NULL;
+    game->chunk_generation = 0;
+    game->chunks = NULL;
+    game->mine_pad = NULL;
+    game->zero_parent = NULL;
+    game->zero_area = NULL;
+    game->workers = NULL;
+    game->cache = NULL;
+    game->renderer = NULL;
+    game->text = NULL;
+    game->pending = NULL;
+    game->pending_count = 0;
+    game->pending_capacity = 0;
+    game->data_saved = false;
+    game->write_volume = 0;
+    game->win_w = width;
+    game->win_h = height;
+    alloc_chunks(game, calc_window_radius(width, height));
+}
+
 /**
  * Initializes the game structure
  * \param game The game to initialize
@@ -59,132 +87,180 @@ void init_game(Game *game) {
     game->space_pressed = false;
     game->mx = 0;
     game->my = 0;
-    game->vx = (CHUNK_HEIGHT - BORDER_SIZE) * SQUARE_SIZE;
-    game->vy = (CHUNK_WIDTH - BORDER_SIZE) * SQUARE_SIZE;
+    // The viewport is centered on the center chunk
+    game->vx = game->radius * CHUNK_PX_WIDTH + (CHUNK_PX_WIDTH - game->win_w) / 2;
+    game->vy = game->radius * CHUNK_PX_HEIGHT + (CHUNK_PX_HEIGHT - game->win_h) / 2;
     game->cx = 1;
     game->cy = 1;
 
-    start_game(game, 15, 15);
-}
-
-/**
- * Initializes the grid with 0s
- * \param grid The grid to initialize
- */
-void init_grid(uint8_t grid[MAP_HEIGHT][MAP_WIDTH]) {
-    for (int row = 0; row < MAP_HEIGHT; row++) {
-        for (int col = 0; col < MAP_WIDTH; col++) {
-            grid[row][col] = 0;
-        }
+    // Starts at the center of the center chunk
+    int row = game->radius * CHUNK_HEIGHT + CHUNK_HEIGHT / 2;
+    int col = game->radius * CHUNK_WIDTH + CHUNK_WIDTH / 2;
+    start_game(game, row, col);
+}
+
+/**
+ * Calculates the number of chunks to load on each side of the center chunk
+ * \param width The width of the window
+ * \param height The height of the window
+ * \return The smallest radius for which the viewport stays in the grid while the center chunk
+ * holds the center of the viewport
+ */
+int calc_window_radius(int width, int height) {
+    int radius_w = (width + 2*CHUNK_PX_WIDTH - 1) / (2*CHUNK_PX_WIDTH);
+    int radius_h = (height + 2*CHUNK_PX_HEIGHT - 1) / (2*CHUNK_PX_HEIGHT);
+    int radius = radius_w > radius_h ? radius_w : radius_h;
+    return radius > 1 ? radius : 1;
+}
+
+/**
+ * Allocates the chunk buffers of the grid
+ * \param game The game to allocate the chunks for
+ * \param radius The number of chunks to load on each side of the center chunk
+ * \note The previous chunk buffers are freed, the new ones are cleared
+ */
+void alloc_chunks(Game *game, int radius) {
+    free_chunks(game);
+    game->radius = radius;
+    game->size = 2*radius + 1;
+    game->map_w = game->size * CHUNK_WIDTH;
+    game->map_h = game->size * CHUNK_HEIGHT;
+    game->pad_stride = (game->map_w + 31) / 32 * 32 + 64; // room for 32-byte loads at any offset
+    game->chunk_buffers = (Chunk *)malloc(game->size * game->size * sizeof(Chunk));
+    game->chunk_generation++;
+    game->chunks = (Chunk **)malloc(game->size * game->size * sizeof(Chunk *));
+    game->mine_pad = (uint8_t *)malloc((game->map_h + 2) * game->pad_stride);
+    game->zero_parent = (int *)malloc(game->size * game->size * MAX_ZERO_COMPONENTS * sizeof(int));
+    game->zero_area = (uint64_t *)malloc(game->size * game->size * CHUNK_HEIGHT * sizeof(uint64_t));
+    if (game->chunk_buffers == NULL || game->chunks == NULL || game->mine_pad == NULL || game->zero_parent == NULL
+        || game->zero_area == NULL) {
+        fprintf(stderr, "Error allocating the chunks\n");
+        exit(1);
     }
+    init_chunks(game);
 }
 
 /**
- * Loads the chunks to the grid
- * \param grid The grid to load the chunks to
- * \param chunks The chunks to load
+ * Frees the chunk buffers of the grid
+ * \param game The game to free the chunks of
  */
-void load_chunks_to_grid(uint8_t grid[MAP_HEIGHT][MAP_WIDTH], uint8_t chunks[3][3][CHUNK_HEIGHT][CHUNK_WIDTH]) {
-    for (int i = 0; i < 3; i++) { // row
-        for (int j = 0; j < 3; j++) { // col
-            for (int row = 0; row < CHUNK_HEIGHT; row++) {
-                for (int col = 0; col < CHUNK_WIDTH; col++) {
-                    grid[i*CHUNK_HEIGHT + row][j*CHUNK_WIDTH + col] = chunks[i][j][row][col];
-                }
-            }
-        }
-    }
+void free_chunks(Game *game) {
+    free(game->chunk_buffers);
+    free(game->chunks);
+    free(game->mine_pad);
+    free(game->zero_parent);
+    free(game->zero_area);
+    game->chunk_buffers = NULL;
+    game->chunks = NULL;
+    game->mine_pad = NULL;
+    game->zero_parent = NULL;
+    game->zero_area = NULL;
 }
 
 /**
- * Generates the numbers in the grid
- * \param grid The grid to generate the numbers in
+ * Clears the chunk buffers and lays them out in the grid
+ * \param game The game to initialize the chunks of
  */
-void gen_numbers(uint8_t grid[MAP_HEIGHT][MAP_WIDTH]) {
-    for (int row = 0; row < MAP_HEIGHT; row++) {
-        for (int col = 0; col < MAP_WIDTH; col++) {
-            if (get_tile_value(grid[row][col]) == 9) {
-                continue;
-            }
-
-            int count = 0;
-            for (int i = -1; i < 2; i++) {
-                for (int j = -1; j < 2; j++) {
-                    if (!in_grid(row+i, col+j)) {
-                        continue;
-                    }
-                    if (get_tile_value(grid[row+i][col+j]) == 9) {
-                        count++;
-                    }
-                }
-            }
-            store_tile_value(&grid[row][col], count);
-        }
+void init_chunks(Game *game) {
+    memset(game->chunk_buffers, 0, game->size * game->size * sizeof(Chunk));
+    for (int i = 0; i < game->size * game->size; i++) {
+        game->chunks[i] = &game->chunk_buffers[i];
+        game->chunks[i]->zero_stale = true;
+        game->chunks[i]->dirty = true;
     }
+    game->zero_stale = true;
 }
 
 /**
  * Generates a chunk
  * \param chunk The chunk to generate
+ * \param seed The world seed
+ * \param crow The row of the chunk
+ * \param ccol The column of the chunk
+ * \param safe The tiles that can't be mines, one bit per tile as in the bitplanes, NULL for none
+ * \note The same seed, coordinates and safe tiles always give the same chunk
  */
-void gen_chunk(uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH]) {
+void gen_chunk(uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH], uint64_t seed, int crow, int ccol, const uint64_t safe[CHUNK_HEIGHT]) {
     for (int row = 0; row < CHUNK_HEIGHT; row++) {
         for (int col = 0; col < CHUNK_WIDTH; col++) {
             chunk[row][col] = 0;
         }
     }
-    gen_mines(chunk);
+    uint64_t state = chunk_seed(seed, crow, ccol);
+    gen_mines(chunk, &state, safe);
 }
 
 /**
  * Generates the mines in a chunk
  * \param chunk The chunk to generate the mines in
- */
-void gen_mines(uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH]) {
-    for (int i = 0; i < MINES; i++) {
-        int row = rand() % CHUNK_HEIGHT;
-        int col = rand() % CHUNK_WIDTH;
-        if (chunk[row][col] == 9) {
-            i--;
-        } else {
-            chunk[row][col] = 9;
-        }
-    }   
-}
-
-/**
- * Creates the tiles for the full grid
- */
-void create_tiles(Game *game) {
-    SSGE_DestroyAllObjects();
-    for (int row = 0; row < MAP_HEIGHT; row++) {
-        for (int col = 0; col < MAP_WIDTH; col++) {
-            char name[20];
-            sprintf(name, "%d_%d", row, col);
-            SSGE_Texture *texture;
-            uint8_t value, state;
-            get_tile_info(game->grid[row][col], &value, &state);
-            switch (state)  {
-                case HIDDEN:
-                    texture = SSGE_GetTexture(T_HIDDEN);
-                    break;
-                case FLAGGED:
-                    texture = SSGE_GetTexture(T_FLAG);
-                    break;
-                case REVEALED:
-                    if (value == 9) {
-                        texture = SSGE_GetTexture(T_WRONG);
-                    } else {
-                        texture = SSGE_GetTexture(value + NUMBER_TILE_OFFSET);
-                    }
-                    break;
-                default:
-                    texture = SSGE_GetTexture(T_HIDDEN);
-                    break;
+ * \param state The state of the random generator
+ * \param safe The tiles that can't be mines, NULL for none
+ * \note Uses Floyd's sampling over the allowed tiles, one draw per mine whatever the density
+ */
+void gen_mines(uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH], uint64_t *state, const uint64_t safe[CHUNK_HEIGHT]) {
+    uint8_t *tiles = &chunk[0][0];
+    uint8_t allowed[CHUNK_HEIGHT * CHUNK_WIDTH];
+    int count = 0;
+    for (int row = 0; row < CHUNK_HEIGHT; row++) {
+        for (int col = 0; col < CHUNK_WIDTH; col++) {
+            if (safe == NULL || !((safe[row] >> col) & 1)) {
+                allowed[count++] = (uint8_t)(row * CHUNK_WIDTH + col);
             }
-            SSGE_CreateObject(name, texture, col * SQUARE_SIZE - game->vx, row * SQUARE_SIZE - game->vy, SQUARE_SIZE, SQUARE_SIZE, false, NULL, NULL);
         }
     }
+    for (int i = count > MINES ? count - MINES : 0; i < count; i++) {
+        int tile = allowed[random_below(state, i + 1)];
+        // If the drawn tile is already a mine, the tile i can't have been drawn yet
+        tiles[tiles[tile] == 9 ? allowed[i] : tile] = 9;
+    }
+}
+
+/**
+ * Gets the tiles of a chunk around the start tile, which can't be mines
+ * \param crow The row of the chunk in the game grid
+ * \param ccol The column of the chunk in the game grid
+ * \param row The row of the start tile
+ * \param col The column of the start tile
+ * \param safe The variable to store the tiles in, one bit per tile as in the bitplanes
+ * \return True if the chunk has tiles around the start tile
+ */
+bool get_safe_tiles(int crow, int ccol, int row, int col, uint64_t safe[CHUNK_HEIGHT]) {
+    bool any = false;
+    int col0 = col - 1 - ccol*CHUNK_WIDTH;
+    uint64_t mask = 0;
+    for (int j = col0; j < col0 + 3; j++) {
+        if (j >= 0 && j < CHUNK_WIDTH) {
+            mask |= 1ULL << j;
+        }
+    }
+    for (int i = 0; i < CHUNK_HEIGHT; i++) {
+        int dist = crow*CHUNK_HEIGHT + i - row;
+        safe[i] = dist >= -1 && dist <= 1 ? mask : 0;
+        any |= safe[i] != 0;
+    }
+    return any;
+}
+
+/**
+ * Gets the texture of a tile
+ * \param game The game the tile is in
+ * \param row The row of the tile
+ * \param col The column of the tile
+ * \return The id of the texture, the mines and the bad flags are shown once the game is over
+ */
+uint8_t tile_texture(Game *game, int row, int col) {
+    uint8_t value, state;
+    get_tile_info(*get_tile(game, row, col), &value, &state);
+    switch (state)  {
+        case HIDDEN:
+            return game->game_over && value == 9 ? T_MINE : T_HIDDEN;
+        case FLAGGED:
+            return game->game_over && value != 9 ? T_BADFLAG : T_FLAG;
+        case REVEALED:
+            return value == 9 ? T_WRONG : value + NUMBER_TILE_OFFSET;
+        default:
+            return T_HIDDEN;
+    }
 }
 
 /**
@@ -192,64 +268,80 @@ void create_tiles(Game *game) {
  * \param game The game to start
  */
 void start_game(Game *game, int row, int col) {
-    init_grid(game->grid);
+    init_chunks(game);
     if (!file_exists("saves/data.msav")) {
-        uint8_t chunks[3][3][CHUNK_HEIGHT][CHUNK_WIDTH];
-        for (int i = 0; i < 3; i++) {
-            for (int j = 0; j < 3; j++) {
-                gen_chunk(chunks[i][j]);
+        // The tiles around the start tile are left out of the mines, so it is always a 0. The chunks
+        // holding them are revealed by the start and saved, the others are generated from the seed
+        game->seed = gen_seed();
+        for (int crow = 0; crow < game->size; crow++) {
+            for (int ccol = 0; ccol < game->size; ccol++) {
+                uint64_t safe[CHUNK_HEIGHT];
+                bool has_safe = get_safe_tiles(crow, ccol, row, col, safe);
+                gen_chunk(get_chunk(game, crow, ccol)->tiles, game->seed, crow + game->cy - game->radius, ccol + game->cx - game->radius, has_safe ? safe : NULL);
             }
         }
-        load_chunks_to_grid(game->grid, chunks);
-        gen_numbers(game->grid);
-
-        while (game->grid[row][col] != 0) {
-            gen_chunk(chunks[1][1]);
-            load_chunks_to_grid(game->grid, chunks);
-            gen_numbers(game->grid);
-        }
+        build_planes(game);
+        gen_numbers(game);
+        clear_pending_reveals(game);
 
-        create_tiles(game);
         reveal_tile(game, row, col);
         save_chunks(game);
     } else {
         load_data(game);
-        load_chunks(game, game->cx, game->cy);
-        create_tiles(game);
+        load_chunks(game, game->cy, game->cx);
     }
+    prefetch_chunks(game);
 }
 
 /**
- * Reveals a tile
+ * Reveals a tile, and the area around it if it is a 0
  * \param game The game to reveal the tile in
  * \param row The row of the tile to reveal
  * \param col The column of the tile to reveal
  */
 void reveal_tile(Game *game, int row, int col) {
-    store_tile_state(&game->grid[row][col], REVEALED);
-    char name[10];
-    sprintf(name, "%d_%d", row, col);
-    SSGE_Object *obj = SSGE_GetObjectByName(name);
-    uint8_t value = get_tile_value(game->grid[row][col]);
+    uint8_t value = get_tile_value(*get_tile(game, row, col));
     if (value == 9) {
-        SSGE_ChangeObjectTexture(obj, SSGE_GetTexture(T_WRONG));
-        reveal_bombs(game, row, col);
+        set_tile_state(game, row, col, REVEALED);
+        reveal_bombs(game);
         game->game_over = true;
-    } else {
-        game->score++;
-        SSGE_ChangeObjectTexture(obj, SSGE_GetTexture(value + NUMBER_TILE_OFFSET));
-        if (value == 0) {
-            for (int i = -1; i < 2; i++) {
-                for (int j = -1; j < 2; j++) {
-                    if (!in_grid(row+i, col+j)) {
-                        continue;
-                    }
-                    uint8_t state = get_tile_state(game->grid[row+i][col+j]);
-                    if (state == HIDDEN) {
-                        reveal_tile(game, row+i, col+j);
-                    }
-                }
-            }
+        return;
+    }
+    game->score += reveal_area(game, row, col);
+}
+
+/**
+ * Reveals a safe tile, and the area around it if it is a 0
+ * \param game The game to reveal the tile in
+ * \param row The row of the tile, which must be hidden and not a mine
+ * \param col The column of the tile
+ * \return The number of revealed tiles
+ */
+int reveal_area(Game *game, int row, int col) {
+    if (get_tile_value(*get_tile(game, row, col)) == 0) {
+        return reveal_zero_area(game, row, col);
+    }
+    set_tile_state(game, row, col, REVEALED);
+    return 1;
+}
+
+/**
+ * Reveals the hidden tiles around a tile
+ * \param game The game to reveal the tiles in
+ * \param row The row of the tile
+ * \param col The column of the tile
+ */
+void reveal_neighbours(Game *game, int row, int col) {
+    uint16_t hidden = neighbourhood_mask(game, row, col)
+        & ~neighbourhood_bits(game, P_REVEALED, row, col)
+        & ~neighbourhood_bits(game, P_FLAGGED, row, col);
+    while (hidden) {
+        int bit = __builtin_ctz(hidden);
+        hidden &= hidden - 1;
+        int i = row + bit / 3 - 1;
+        int j = col + bit % 3 - 1;
+        if (get_tile_state(*get_tile(game, i, j)) == HIDDEN) { // may have been revealed by a previous neighbour
+            reveal_tile(game, i, j);
         }
     }
 }
@@ -258,26 +350,9 @@ void reveal_tile(Game *game, int row, int col) {
  * Reveals all bombs
  * \param game The game to reveal the bombs in
  */
-void reveal_bombs(Game *game, int row, int col) {
-    for (int i = 0; i < MAP_HEIGHT; i++) { // row
-        for (int j = 0; j < MAP_WIDTH; j++) { // col
-            char name[10];
-            sprintf(name, "%d_%d", i, j);
-            SSGE_Object *obj = SSGE_GetObjectByName(name);
-            uint8_t value, state;
-            get_tile_info(game->grid[i][j], &value, &state);
-            if ((i == row && j == col) || state == REVEALED) {
-                continue;
-            }
-            if (state == FLAGGED && value == 9) {
-                continue;
-            } else if (state == FLAGGED && value != 9) {
-                SSGE_ChangeObjectTexture(obj, SSGE_GetTexture(T_BADFLAG));
-            } else if (value == 9) {
-                SSGE_ChangeObjectTexture(obj, SSGE_GetTexture(T_MINE));
-            }
-        }
-    }
+void reveal_bombs(Game *game) {
+    // The mines and the bad flags are drawn from the game over state, every chunk is drawn again
+    invalidate_render_rect(game, 0, 0, game->map_h, game->map_w);
 }
 
 /**
@@ -287,31 +362,36 @@ void reveal_bombs(Game *game, int row, int col) {
  * \param col The column of the number tile
  */
 void reveal_number(Game *game, int row, int col) {
-    uint8_t n = get_tile_value(game->grid[row][col]);
-    int flag_count = 0;
-    for (int i = -1; i < 2; i++) {
-        for (int j = -1; j < 2; j++) {
-            if (!in_grid(row+i, col+j)) {
-                continue;
-            }
-            if (get_tile_state(game->grid[row+i][col+j]) == FLAGGED) {
-                flag_count++;
-            }
-        }
-    }
-    if (flag_count != n) {
+    uint8_t n = get_tile_value(*get_tile(game, row, col));
+    if (*get_flag_count(game, row, col) != n) {
         return;
     }
-    for (int i = -1; i < 2; i++) {
-        for (int j = -1; j < 2; j++) {
-            if (!in_grid(row+i, col+j)) {
-                continue;
-            }
-            if (get_tile_state(game->grid[row+i][col+j]) == HIDDEN) {
-                reveal_tile(game, row+i, col+j);
-            }
-        }
+    reveal_neighbours(game, row, col);
+}
+
+/**
+ * Resizes the viewport and reloads the grid if the window radius changed
+ * \param game The game to resize the viewport for
+ * \param width The new width of the window
+ * \param height The new height of the window
+ */
+void resize_window(Game *game, int width, int height) {
+    // Keeps the center of the viewport in place
+    game->vx += (game->win_w - width) / 2;
+    game->vy += (game->win_h - height) / 2;
+    game->win_w = width;
+    game->win_h = height;
+
+    int radius = calc_window_radius(width, height);
+    if (radius == game->radius) {
+        return;
     }
+    save_chunks(game);
+    game->vx += (radius - game->radius) * CHUNK_PX_WIDTH;
+    game->vy += (radius - game->radius) * CHUNK_PX_HEIGHT;
+    alloc_chunks(game, radius);
+    load_chunks(game, game->cy, game->cx);
+    prefetch_chunks(game);
 }
 
 /**
@@ -321,8 +401,8 @@ void reveal_number(Game *game, int row, int col) {
  * \param y The variable to store the y coordinate in
  */
 void calc_current_centered_chunk(Game *game, int *x, int *y) {
-    *x = (int)floor((game->vx + (game->cx * CHUNK_WIDTH + BORDER_SIZE) * SQUARE_SIZE + (CHUNK_WIDTH  * SQUARE_SIZE) / 2) / (CHUNK_WIDTH * SQUARE_SIZE)) - 1;
-    *y = (int)floor((game->vy + (game->cy * CHUNK_HEIGHT + BORDER_SIZE) * SQUARE_SIZE + (CHUNK_HEIGHT * SQUARE_SIZE) / 2) / (CHUNK_HEIGHT * SQUARE_SIZE)) - 1;
+    *x = game->cx - game->radius + (int)floor((double)(game->vx + game->win_w / 2) / CHUNK_PX_WIDTH);
+    *y = game->cy - game->radius + (int)floor((double)(game->vy + game->win_h / 2) / CHUNK_PX_HEIGHT);
 }
 
 /**
@@ -332,20 +412,30 @@ void calc_current_centered_chunk(Game *game, int *x, int *y) {
  * \param dy The y direction of the shift
  */
 void shift_game_chunks(Game *game, int dx, int dy) {
-    uint8_t result[MAP_HEIGHT][MAP_WIDTH];
-    init_grid(result);
-    for (int row = 0; row < MAP_HEIGHT; row++) {
-        for (int col = 0; col < MAP_WIDTH; col++) {
-            if (in_grid(row + dy * CHUNK_HEIGHT, col + dx * CHUNK_WIDTH)) {
-                result[row][col] = game->grid[row + dy * CHUNK_HEIGHT][col + dx * CHUNK_WIDTH];
+    int size = game->size;
+    Chunk *result[size * size];
+    Chunk *unloaded[size * size];
+    int count = 0;
+    memset(result, 0, sizeof(result));
+    for (int crow = 0; crow < size; crow++) {
+        for (int ccol = 0; ccol < size; ccol++) {
+            int row = crow - dy;
+            int col = ccol - dx;
+            if (row >= 0 && row < size && col >= 0 && col < size) {
+                result[row*size + col] = get_chunk(game, crow, ccol);
+            } else {
+                unloaded[count++] = get_chunk(game, crow, ccol);
             }
         }
     }
-    for (int row = 0; row < MAP_HEIGHT; row++) {
-        for (int col = 0; col < MAP_WIDTH; col++) {
-            game->grid[row][col] = result[row][col];
+    // The buffers of the chunks that left the grid are reused for the new ones
+    for (int i = 0; i < size * size; i++) {
+        if (result[i] == NULL) {
+            result[i] = unloaded[--count];
+            memset(result[i], 0, sizeof(Chunk));
         }
     }
+    memcpy(game->chunks, result, sizeof(result));
 }
 
 /**
@@ -356,21 +446,15 @@ void shift_game_chunks(Game *game, int dx, int dy) {
  * \param col The column of the mine (in the chunk)
  * \param crow The row of the chunk
  * \param ccol The column of the chunk
+ * \return True if the mine was removed
  */
-void check_mine_valid(Game *game, uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH], int row, int col, int crow, int ccol) {
+bool check_mine_valid(Game *game, uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH], int row, int col, int crow, int ccol) {
     //check around the mine if there is already a number
-    for (int i = -1; i < 2; i++) {
-        for (int j = -1; j < 2; j++) {
-            if (!in_grid(crow*CHUNK_HEIGHT + row + i, ccol*CHUNK_WIDTH + col + j)) {
-                continue;
-            }
-            uint8_t state = get_tile_state(game->grid[crow*CHUNK_HEIGHT + row + i][ccol*CHUNK_WIDTH + col + j]);
-            if (state == REVEALED) {
-                chunk[row][col] = 0;
-                return;
-            }
-        }
+    if (neighbourhood_bits(game, P_REVEALED, crow*CHUNK_HEIGHT + row, ccol*CHUNK_WIDTH + col) != 0) {
+        chunk[row][col] = 0;
+        return true;
     }
+    return false;
 }
 
 /**
@@ -381,28 +465,31 @@ void check_mine_valid(Game *game, uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH], int
  * \param col The column where the chunk should be added in the game grid
  * \param crow The row of the chunk to load
  * \param ccol The column of the chunk to load
+ * \note The chunk is taken from the chunk cache, or from the ready cache of the workers when it is
+ * ready there
  */
 void add_chunk_to_game(Game *game, int row, int col, int crow, int ccol) {
-    uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH];
-    char filename[50];
-    sprintf(filename, "saves/%d.%d.msav", game->cy + row - 1, game->cx + col - 1);
-    bool exists = file_exists(filename);
-    if (exists) {
-        load_chunk(chunk, crow, ccol);
-    } else {
-        gen_chunk(chunk);
+    Chunk *buffer = get_chunk(game, row, col);
+    uint8_t (*chunk)[CHUNK_WIDTH] = buffer->tiles;
+    bool exists = read_cached_chunk(game, chunk, crow, ccol);
+    if (!exists && !take_ready_chunk(game, crow, ccol, chunk, &exists)) {
+        exists = load_chunk(chunk, crow, ccol);
+        if (!exists) {
+            gen_chunk(chunk, game->seed, crow, ccol, NULL);
+        }
     }
-    for (int i = 0; i < CHUNK_HEIGHT; i++) {
-        for (int j = 0; j < CHUNK_WIDTH; j++) {
-            if (!exists) {
+    buffer->stored = exists;
+    if (!exists) {
+        for (int i = 0; i < CHUNK_HEIGHT; i++) {
+            for (int j = 0; j < CHUNK_WIDTH; j++) {
                 bool is_border = i == 0 || i == CHUNK_WIDTH-1 || j == 0 || j == CHUNK_HEIGHT-1;
-                if (is_border && chunk[i][j] == 9) {
-                    check_mine_valid(game, chunk, i, j, row, col);
+                if (is_border && chunk[i][j] == 9 && check_mine_valid(game, chunk, i, j, row, col)) {
+                    buffer->stored = buffer->unsaved = true;
                 }
             }
-            game->grid[row*CHUNK_HEIGHT + i][col*CHUNK_WIDTH + j] = chunk[i][j];
         }
     }
+    build_chunk_planes(buffer);
 }
 
 /**
@@ -410,26 +497,41 @@ void add_chunk_to_game(Game *game, int row, int col, int crow, int ccol) {
  * \param game The game to post process the shift for
  * \param dx The x direction of the shift
  * \param dy The y direction of the shift
+ * \note Numbers are only regenerated in the new chunks, the seam next to them and the opposite
+ * edge of the grid, which lost its outer neighbours
  */
 void post_process_shift_chunks(Game *game, int dx, int dy) {
     if (dx != 0) {
-        int col = dx == 1 ? 2 : 0;
-        for (int row = 0; row < 3; row++) {
-            int crow = game->cy + row - 1;
-            int ccol = game->cx + col - 1;
+        int col = dx == 1 ? game->size - 1 : 0;
+        for (int row = 0; row < game->size; row++) {
+            int crow = game->cy + row - game->radius;
+            int ccol = game->cx + col - game->radius;
             add_chunk_to_game(game, row, col, crow, ccol);
         }
     }
     if (dy != 0) {
-        int row = dy == 1 ? 2 : 0;
-        for (int col = 0; col < 3; col++) {
-            int crow = game->cy + row - 1;
-            int ccol = game->cx + col - 1;
+        int row = dy == 1 ? game->size - 1 : 0;
+        for (int col = 0; col < game->size; col++) {
+            int crow = game->cy + row - game->radius;
+            int ccol = game->cx + col - game->radius;
             add_chunk_to_game(game, row, col, crow, ccol);
         }
     }
 
-    gen_numbers(game->grid);
+    if (dx != 0) {
+        int col = dx == 1 ? game->map_w - CHUNK_WIDTH - 1 : 0;
+        int edge = dx == 1 ? 0 : game->map_w - 1;
+        gen_numbers_rect(game, 0, col, game->map_h, col + CHUNK_WIDTH + 1);
+        gen_numbers_rect(game, 0, edge, game->map_h, edge + 1);
+    }
+    if (dy != 0) {
+        int row = dy == 1 ? game->map_h - CHUNK_HEIGHT - 1 : 0;
+        int edge = dy == 1 ? 0 : game->map_h - 1;
+        gen_numbers_rect(game, row, 0, row + CHUNK_HEIGHT + 1, game->map_w);
+        gen_numbers_rect(game, edge, 0, edge + 1, game->map_w);
+    }
+    drain_pending_reveals(game);
+    prefetch_chunks(game);
 }
 
 /**
@@ -437,18 +539,35 @@ void post_process_shift_chunks(Game *game, int dx, int dy) {
  * \param game The game to save
  */
 void save_data(Game *game) {
-    FILE *file = fopen("saves/data.msav", "wb");
-    if (file == NULL) {
-        fprintf(stderr, "Error opening file saves/data.msav\n");
-        exit(1);
+    // The viewport is saved as the position of its center in the center chunk, so it does not
+    // depend on the window size
+    int vx = game->vx + game->win_w / 2 - game->radius * CHUNK_PX_WIDTH;
+    int vy = game->vy + game->win_h / 2 - game->radius * CHUNK_PX_HEIGHT;
+    uint8_t data[DATA_SAVE_SIZE];
+    uint8_t *ptr = data;
+    *ptr++ = DATA_SAVE_VERSION;
+    memcpy(ptr, &game->score, sizeof(uint32_t)); ptr += sizeof(uint32_t);
+    memcpy(ptr, &game->game_over, sizeof(bool)); ptr += sizeof(bool);
+    memcpy(ptr, &vx, sizeof(int)); ptr += sizeof(int);
+    memcpy(ptr, &vy, sizeof(int)); ptr += sizeof(int);
+    memcpy(ptr, &game->cy, sizeof(int)); ptr += sizeof(int);
+    memcpy(ptr, &game->cx, sizeof(int)); ptr += sizeof(int);
+    memcpy(ptr, &game->seed, sizeof(uint64_t));
+
+    // The file is only written when one of its fields changed
+    if (!game->data_saved || memcmp(data, game->saved_data, DATA_SAVE_SIZE) != 0) {
+        FILE *file = fopen("saves/data.msav", "wb");
+        if (file == NULL) {
+            fprintf(stderr, "Error opening file saves/data.msav\n");
+            exit(1);
+        }
+        fwrite(data, 1, DATA_SAVE_SIZE, file);
+        fclose(file);
+        memcpy(game->saved_data, data, DATA_SAVE_SIZE);
+        game->data_saved = true;
+        game->write_volume += DATA_SAVE_SIZE;
     }
-    fwrite(&game->score, sizeof(uint32_t), 1, file);
-    fwrite(&game->game_over, sizeof(bool), 1, file);
-    fwrite(&game->vx, sizeof(int), 1, file);
-    fwrite(&game->vy, sizeof(int), 1, file);
-    fwrite(&game->cy, sizeof(int), 1, file);
-    fwrite(&game->cx, sizeof(int), 1, file);
-    fclose(file);
+    save_pending_reveals(game);
 }
 
 /**
@@ -461,89 +580,132 @@ void load_data(Game *game) {
         fprintf(stderr, "Error opening file saves/data.msav\n");
         exit(1);
     }
-    fread(&game->score, sizeof(uint32_t), 1, file);
-    fread(&game->game_over, sizeof(bool), 1, file);
-    fread(&game->vx, sizeof(int), 1, file);
-    fread(&game->vy, sizeof(int), 1, file);
-    fread(&game->cx, sizeof(int), 1, file);
-    fread(&game->cy, sizeof(int), 1, file);
+    uint8_t data[DATA_SAVE_SIZE];
+    size_t size = fread(data, 1, DATA_SAVE_SIZE, file);
     fclose(file);
-}
+    if (size < LEGACY_DATA_SIZE) {
+        fprintf(stderr, "Error reading file saves/data.msav\n");
+        exit(1);
+    }
 
-/**
- * Save a single chunk in a file
- * \param chunk The chunk to save
- * \param row The row of the chunk
- * \param col The column of the chunk
- */
-void save_chunk(uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH], int row, int col) {
-    char filename[50];
-    sprintf(filename, "saves/%d.%d.msav", row, col);
-    FILE *file = fopen(filename, "wb");
-    fwrite(chunk, sizeof(uint8_t), CHUNK_HEIGHT * CHUNK_WIDTH, file);
-    fclose(file);
+    // The saves without version hold the same fields, without the version byte
+    bool tagged = size == DATA_SAVE_SIZE && data[0] == DATA_SAVE_VERSION;
+    uint8_t *ptr = tagged ? data + 1 : data;
+    int vx, vy;
+    memcpy(&game->score, ptr, sizeof(uint32_t)); ptr += sizeof(uint32_t);
+    memcpy(&game->game_over, ptr, sizeof(bool)); ptr += sizeof(bool);
+    memcpy(&vx, ptr, sizeof(int)); ptr += sizeof(int);
+    memcpy(&vy, ptr, sizeof(int)); ptr += sizeof(int);
+    memcpy(&game->cy, ptr, sizeof(int)); ptr += sizeof(int);
+    memcpy(&game->cx, ptr, sizeof(int)); ptr += sizeof(int);
+    if (tagged || size == DATA_SAVE_SIZE - 1) {
+        memcpy(&game->seed, ptr, sizeof(uint64_t));
+    } else {
+        // Saves of the 3x3 grid: all their chunks are stored, a new seed is only used for new
+        // chunks. Their viewport is its offset in the grid at the default window size
+        game->seed = gen_seed();
+        vx += WIN_W / 2 - CHUNK_PX_WIDTH;
+        vy += WIN_H / 2 - CHUNK_PX_HEIGHT;
+    }
+    load_pending_reveals(game);
+    game->data_saved = false; // Written again once, in the current version
+    game->vx = vx - game->win_w / 2 + game->radius * CHUNK_PX_WIDTH;
+    game->vy = vy - game->win_h / 2 + game->radius * CHUNK_PX_HEIGHT;
 }
 
 /**
- * Saves the chunks of the game
- * \param game The game to save the chunks from
+ * Checks if a chunk must be saved, or can be generated again from the seed
+ * \param game The game the chunk is in
+ * \param crow The row of the chunk in the game grid
+ * \param ccol The column of the chunk in the game grid
+ * \return True if the chunk has a save file, lost mines when generated, has revealed or flagged
+ * tiles, or has a border mine next to a revealed tile (it would be removed when generated again)
  */
-void save_chunks(Game *game) {
-    for (int crow = 0; crow < 3; crow++) { // iter through chunk row
-        for (int ccol = 0; ccol < 3; ccol++) { // iter through chunk col
-            uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH];
-            for (int row = 0; row < CHUNK_HEIGHT; row++) {
-                for (int col = 0; col < CHUNK_WIDTH; col++) {
-                    chunk[row][col] = game->grid[crow*CHUNK_HEIGHT + row][ccol*CHUNK_WIDTH + col];
-                }
+bool chunk_needs_save(Game *game, int crow, int ccol) {
+    Chunk *chunk = get_chunk(game, crow, ccol);
+    if (chunk->stored) {
+        return true;
+    }
+    for (int i = 0; i < CHUNK_HEIGHT; i++) {
+        if (chunk->planes.bits[P_REVEALED][i] | chunk->planes.bits[P_FLAGGED][i]) {
+            return true;
+        }
+    }
+    for (int i = 0; i < CHUNK_HEIGHT; i++) {
+        uint64_t mines = chunk->planes.bits[P_MINE][i];
+        if (i != 0 && i != CHUNK_HEIGHT - 1) {
+            mines &= 1ULL | 1ULL << (CHUNK_WIDTH - 1);
+        }
+        while (mines) {
+            int j = __builtin_ctzll(mines);
+            mines &= mines - 1;
+            if (neighbourhood_bits(game, P_REVEALED, crow*CHUNK_HEIGHT + i, ccol*CHUNK_WIDTH + j) != 0) {
+                return true;
             }
-            save_chunk(chunk, crow + game->cy - 1, ccol + game->cx - 1);
         }
     }
+    return false;
 }
 
 /**
- * Loads a single chunk from a file
- * \param chunk The chunk to load
- * \param row The row of the chunk
- * \param col The column of the chunk
+ * Saves the chunks of the game
+ * \param game The game to save the chunks from
+ * \note The chunks that can be generated again from the seed and the stored chunks that did not
+ * change since they were saved are not saved. The chunks go to the
+ * chunk cache, which writes them back when they are evicted or with `write_back_chunks`
  */
-void load_chunk(uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH], int row, int col) {
-    char filename[30];
-    sprintf(filename, "saves/%d.%d.msav", row, col);
-    FILE *file = fopen(filename, "rb");
-
-    if (file == NULL) {
-        fprintf(stderr, "Error opening file %s\n", filename);
-        exit(1);
-    }
-
-    for (int row = 0; row < CHUNK_HEIGHT; row++) {
-        for (int col = 0; col < CHUNK_WIDTH; col++) {
-            fread(&chunk[row][col], sizeof(uint8_t), 1, file);
+void save_chunks(Game *game) {
+    for (int crow = 0; crow < game->size; crow++) { // iter through chunk row
+        for (int ccol = 0; ccol < game->size; ccol++) { // iter through chunk col
+            Chunk *chunk = get_chunk(game, crow, ccol);
+            // A stored chunk is only saved again if it changed
+            if (chunk->stored ? chunk->unsaved : chunk_needs_save(game, crow, ccol)) {
+                cache_chunk(game, chunk->tiles, crow + game->cy - game->radius, ccol + game->cx - game->radius);
+                chunk->stored = true;
+                chunk->unsaved = false;
+            }
         }
     }
-    fclose(file);
 }
 
 /**
- * Loads 9x9 chunks to the game
+ * Loads the chunks of the grid to the game
  * \param game The game to load the chunks to
  * \param row The row of the center chunk to load
  * \param col The column of the center chunk to load
+ * \note The chunks that were never saved are generated from the seed, after the saved ones so
+ * their mines can be checked against them. The pending reveals of the chunks are drained
  */
 void load_chunks(Game *game, int row, int col) {
-    uint8_t chunks[3][3][CHUNK_HEIGHT][CHUNK_WIDTH];
-    for (int i = -1; i < 2; i++) {
-        for (int j = -1; j < 2; j++) {
-            load_chunk(chunks[i+1][j+1], row+i, col+j);
+    flush_chunk_writes(game);
+    int size = game->size;
+    bool saved[size * size];
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            int crow = row + i - game->radius, ccol = col + j - game->radius;
+            saved[i*size + j] = read_cached_chunk(game, get_chunk(game, i, j)->tiles, crow, ccol);
+            if (!saved[i*size + j]) {
+                saved[i*size + j] = load_chunk(get_chunk(game, i, j)->tiles, crow, ccol);
+            }
+            if (saved[i*size + j]) {
+                build_chunk_planes(get_chunk(game, i, j));
+                get_chunk(game, i, j)->stored = true;
+            }
         }
     }
-    load_chunks_to_grid(game->grid, chunks);
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            if (!saved[i*size + j]) {
+                add_chunk_to_game(game, i, j, row + i - game->radius, col + j - game->radius);
+            }
+        }
+    }
+    gen_numbers(game);
+    drain_pending_reveals(game);
 
-    // for (int row = 0; row < MAP_HEIGHT; row++) {
-    //     for (int col = 0; col < MAP_WIDTH; col++) {
-    //         printf("%d ", game->grid[row][col]);
+    // for (int row = 0; row < game->map_h; row++) {
+    //     for (int col = 0; col < game->map_w; col++) {
+    //         printf("%d ", *get_tile(game, row, col));
     //     }
     //     printf("\n");
     // }
@@ -552,8 +714,14 @@ void load_chunks(Game *game, int row, int col) {
 
 /**
  * Deletes the save files
- */
-void delete_save() {
+ * \param game The game to delete the save of, its cached chunks are dropped and its queued writes
+ * are done first
+ */
+void delete_save(Game *game) {
+    clear_chunk_cache(game);
+    flush_chunk_writes(game);
+    game->data_saved = false;
+    delete_regions();
     DIR *dir = opendir("saves");
     struct dirent *entry;
     while ((entry = readdir(dir)) != NULL) {
@@ -567,6 +735,22 @@ void delete_save() {
             exit(1);
         }
     }
+    closedir(dir);
+}
+
+/**
+ * Prints the number of bytes written to the save files since the start of the session, and the
+ * hits and misses of the chunk cache
+ * \param game The game to print the statistics of
+ * \note The chunks waiting in the chunk cache are not counted until they are written back
+ */
+void print_save_stats(Game *game) {
+    printf("Save files: %llu bytes written this session\n", (unsigned long long)game->write_volume);
+    uint32_t hits, misses;
+    get_chunk_cache_stats(game, &hits, &misses);
+    if (hits + misses > 0) {
+        printf("Chunk cache: %u hits, %u misses (%.1f%% hit rate)\n", hits, misses, 100.0 * hits / (hits + misses));
+    }
 }
 
 
@@ -609,12 +793,12 @@ void save_anim(Game *game) {
     }
     if (df < SAVE_ANIM_FRAMES/2) { // fade in
         int alpha = 255 * df / (SAVE_ANIM_FRAMES/2);
-        SSGE_DrawText("font", "Game saved", 11, 11, (SSGE_Color){0, 0, 0, alpha}, SSGE_NW);
-        SSGE_DrawText("font", "Game saved", 10, 10, (SSGE_Color){255, 255, 255, alpha}, SSGE_NW);
+        draw_text(game, "Game saved", 11, 11, (SSGE_Color){0, 0, 0, alpha}, SSGE_NW);
+        draw_text(game, "Game saved", 10, 10, (SSGE_Color){255, 255, 255, alpha}, SSGE_NW);
     } else { // fade out
         int alpha = 255 - 255 * (df - SAVE_ANIM_FRAMES/2) / (SAVE_ANIM_FRAMES/2);
-        SSGE_DrawText("font", "Game saved", 11, 11, (SSGE_Color){0, 0, 0, alpha}, SSGE_NW);
-        SSGE_DrawText("font", "Game saved", 10, 10, (SSGE_Color){255, 255, 255, alpha}, SSGE_NW);
+        draw_text(game, "Game saved", 11, 11, (SSGE_Color){0, 0, 0, alpha}, SSGE_NW);
+        draw_text(game, "Game saved", 10, 10, (SSGE_Color){255, 255, 255, alpha}, SSGE_NW);
     }
 }
 
@@ -636,13 +820,13 @@ void check_upd_menu_fade(Game *game) {
 void menu_fade(Game *game) {
     game->menu_alpha += (short)(game->menu ? MENU_ALPHA_STEP : -MENU_ALPHA_STEP);
     if (game->menu_alpha <= 0) return;
-    SSGE_FillRect(0, 0, WIN_W, WIN_H, (SSGE_Color){0, 0, 0, game->menu_alpha});
+    SSGE_FillRect(0, 0, game->win_w, game->win_h, (SSGE_Color){0, 0, 0, game->menu_alpha});
     short alpha = game->menu_alpha * 255 / MENU_FADE_MAX_ALPHA;
-    SSGE_DrawText("font", "Game paused", 10, 10, (SSGE_Color){255, 255, 255, alpha}, SSGE_NW);
-    SSGE_DrawText("font", "ESC      : Continue", 10, WIN_H - 110, (SSGE_Color){255, 255, 255, alpha}, SSGE_SW);
-    SSGE_DrawText("font", "SPACE    : Drag the grid", 10, WIN_H - 90, (SSGE_Color){255, 255, 255, alpha}, SSGE_SW);
-    SSGE_DrawText("font", "LMB      : Reveal tile", 10, WIN_H - 70, (SSGE_Color){255, 255, 255, alpha}, SSGE_SW);
-    SSGE_DrawText("font", "RMB      : Flag tile", 10, WIN_H - 50, (SSGE_Color){255, 255, 255, alpha}, SSGE_SW);
-    SSGE_DrawText("font", "S        : Save game", 10, WIN_H - 30, (SSGE_Color){255, 255, 255, alpha}, SSGE_SW);
-    SSGE_DrawText("font", "R        : Reset game", 10, WIN_H - 10, (SSGE_Color){255, 255, 255, alpha}, SSGE_SW);
+    draw_text(game, "Game paused", 10, 10, (SSGE_Color){255, 255, 255, alpha}, SSGE_NW);
+    draw_text(game, "ESC      : Continue", 10, game->win_h - 110, (SSGE_Color){255, 255, 255, alpha}, SSGE_SW);
+    draw_text(game, "SPACE    : Drag the grid", 10, game->win_h - 90, (SSGE_Color){255, 255, 255, alpha}, SSGE_SW);
+    draw_text(game, "LMB      : Reveal tile", 10, game->win_h - 70, (SSGE_Color){255, 255, 255, alpha}, SSGE_SW);
+    draw_text(game, "RMB      : Flag tile", 10, game->win_h - 50, (SSGE_Color){255, 255, 255, alpha}, SSGE_SW);
+    draw_text(game, "S        : Save game", 10, game->win_h - 30, (SSGE_Color){255, 255, 255, alpha}, SSGE_SW);
+    draw_text(game, "R        : Reset game", 10, game->win_h - 10, (SSGE_Color){255, 255, 255, alpha}, SSGE_SW);
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include "game.h"
 
-static void init_assets();
+#include <SDL2/SDL_events.h>
+
+static SSGE_Tilemap *init_assets();
 
 static void draw(Game *game);
 static void handle_input(SSGE_Event event, Game *game);
@@ -14,20 +16,36 @@ int main(int argc, char *argv[]) {
     SSGE_SetManualUpdate(true);
     SSGE_SetBackgroundColor((SSGE_Color){191, 191, 191, 255});
     SSGE_SetWindowIcon("assets/icon.png");
+    SSGE_WindowResizable(true);
 
     srand(time(NULL));
     CreateDirectory("saves", NULL);
+    open_regions();
+    migrate_chunk_files();
 
-    init_assets();
-    SSGE_LoadFont("assets/font.ttf", 20, "font");
+    SSGE_Tilemap *tilemap = init_assets();
 
     Game *game = (Game *)malloc(sizeof(Game));
+    init_window(game, WIN_W, WIN_H);
+    init_tile_renderer(game, tilemap);
+    init_text_renderer(game, "assets/font.ttf", 20);
+    start_workers(game, CHUNK_WORKERS);
+    init_chunk_cache(game, CHUNK_CACHE_RINGS);
     init_game(game);
 
     SSGE_Run(update, draw, handle_input, game);
     save_game(game);
-
+    write_back_chunks(game);
+    print_save_stats(game);
+
+    free_chunk_cache(game);
+    stop_workers(game);
+    close_regions();
+    free_tile_renderer(game);
+    free_text_renderer(game);
     SSGE_Quit();
+    free_chunks(game);
+    free(game->pending);
     free(game);
     return 0;
 }
@@ -37,17 +55,11 @@ int main(int argc, char *argv[]) {
  * \param game The game to draw
  */
 static void draw(Game *game) {
-    for (int row = 0; row < MAP_HEIGHT; row++) {
-        for (int col = 0; col < MAP_WIDTH; col++) {
-            char name[10];
-            sprintf(name, "%d_%d", row, col);
-            SSGE_DrawObject(SSGE_GetObjectByName(name));
-        }
-    }
+    draw_tiles(game);
     char score[20];
     sprintf(score, "Score: %d", game->score);
-    SSGE_DrawText("font", score, 11, WIN_H - 9, (SSGE_Color){0, 0, 0, 255}, SSGE_SW);
-    SSGE_DrawText("font", score, 10, WIN_H - 10, (SSGE_Color){255, 255, 255, 255}, SSGE_SW);
+    draw_text(game, score, 11, game->win_h - 9, (SSGE_Color){0, 0, 0, 255}, SSGE_SW);
+    draw_text(game, score, 10, game->win_h - 10, (SSGE_Color){255, 255, 255, 255}, SSGE_SW);
     char title[50];
     sprintf(title, "Minesweeper - %s - %s", game->game_over ? "Game Over" : "Playing", score);
     SSGE_SetWindowTitle(title);
@@ -65,19 +77,8 @@ static void update(Game *game) {
         SSGE_GetMousePosition(&dx, &dy);
         dx -= game->mx;
         dy -= game->my;
-        if (dx != 0 || dy != 0) {
-            for (int row = 0; row < MAP_HEIGHT; row++) {
-                for (int col = 0; col < MAP_WIDTH; col++) {
-                    char name[10];
-                    sprintf(name, "%d_%d", row, col);
-                    SSGE_Object *obj = SSGE_GetObjectByName(name);
-                    obj->x += dx;
-                    obj->y += dy;
-                }
-            }
-            game->vx -= dx;
-            game->vy -= dy;
-        }
+        game->vx -= dx;
+        game->vy -= dy;
         int x, y;
         calc_current_centered_chunk(game, &x, &y);
         if (x != game->cx || y != game->cy) { // If the centered chunk has changed
@@ -90,9 +91,8 @@ static void update(Game *game) {
             shift_game_chunks(game, dx, dy);
             post_process_shift_chunks(game, dx, dy);
 
-            game->vx -= dx * CHUNK_WIDTH * SQUARE_SIZE;
-            game->vy -= dy * CHUNK_HEIGHT * SQUARE_SIZE;
-            create_tiles(game);
+            game->vx -= dx * CHUNK_PX_WIDTH;
+            game->vy -= dy * CHUNK_PX_HEIGHT;
         }
         SSGE_ManualUpdate();
     }
@@ -110,9 +110,20 @@ static void update(Game *game) {
 static void handle_input(SSGE_Event event, Game *game) {
     bool update = false;
     switch (event.type) {
+        case (SSGE_WINDOWEVENT):
+            if (event.window.event == SSGE_WINDOWEVENT_RESIZED) {
+                resize_window(game, event.window.data1, event.window.data2);
+                update = true;
+            }
+            break;
+        case (SDL_RENDER_TARGETS_RESET): // The chunk render targets lost their contents
+        case (SDL_RENDER_DEVICE_RESET): // The chunk render targets must be created again
+            reset_render_targets(game, event.type == SDL_RENDER_DEVICE_RESET);
+            update = true;
+            break;
         case (SSGE_MOUSEBUTTONDOWN):
             if (game->game_over) {
-                delete_save();
+                delete_save(game);
                 init_game(game);
                 SSGE_ManualUpdate();
                 return;
@@ -123,7 +134,7 @@ static void handle_input(SSGE_Event event, Game *game) {
                 int row = (y + game->vy) / SQUARE_SIZE;
                 int col = (x + game->vx) / SQUARE_SIZE;
                 uint8_t value, state;
-                get_tile_info(game->grid[row][col], &value, &state);
+                get_tile_info(*get_tile(game, row, col), &value, &state);
                 switch (event.button.button) {
                     case (SSGE_MOUSE_LEFT):
                         if (state == FLAGGED) break;
@@ -132,16 +143,8 @@ static void handle_input(SSGE_Event event, Game *game) {
                         update = true;
                         break;
                     case (SSGE_MOUSE_RIGHT):
-                        char name[20];
-                        sprintf(name, "%d_%d", row, col);
-                        SSGE_Object *obj = SSGE_GetObjectByName(name);
-                        if (state == HIDDEN) {
-                            store_tile_state(&game->grid[row][col], FLAGGED);
-                            SSGE_ChangeObjectTexture(obj, SSGE_GetTexture(T_FLAG));
-                        } else if (state == FLAGGED) {
-                            store_tile_state(&game->grid[row][col], HIDDEN);
-                            SSGE_ChangeObjectTexture(obj, SSGE_GetTexture(T_HIDDEN));
-                        }
+                        if (state == HIDDEN) set_tile_state(game, row, col, FLAGGED);
+                        else if (state == FLAGGED) set_tile_state(game, row, col, HIDDEN);
                         update = true;
                         break;
                 }
@@ -165,13 +168,14 @@ static void handle_input(SSGE_Event event, Game *game) {
                     if (!game->menu) {
                         if (!game->game_over) {
                             save_game(game);
+                            write_back_chunks(game);
                             game->save_frame = game->frame_count;
                         }
                     }
                     break;
                 case (SSGE_KEY_r): // Restart
                     if (!game->menu) {
-                        delete_save();
+                        delete_save(game);
                         init_game(game);
                         update = true;
                     }
@@ -187,8 +191,9 @@ static void handle_input(SSGE_Event event, Game *game) {
 
 /**
  * Initializes the assets
+ * \return The tilemap of the tiles, used as the atlas of the tile renderer
  */
-static void init_assets() {
+static SSGE_Tilemap *init_assets() {
     SSGE_Tilemap *tilemap = SSGE_LoadTilemap("assets/tiles.png", 6, 6, 0, 4, 4);
 
     // From 0 - 5
@@ -209,5 +214,6 @@ static void init_assets() {
     SSGE_GetTileAsTexture("7", tilemap, 1, 2);
     SSGE_GetTileAsTexture("8", tilemap, 1, 3);
 
-    SSGE_DestroyTilemap(tilemap);
+    // Kept as the atlas of the tile renderer
+    return tilemap;
 }
@@ -0,0 +1,183 @@
+#include "game.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define NUMBERS_X86
+#endif
+
+/**
+ * Row kernel of `gen_numbers`
+ * \param mines The halo-padded mine plane, pointing on the row above the row to compute
+ * \param stride The stride of the mine plane
+ * \param tiles The tiles of the row to compute, padded to the stride of the mine plane
+ * \param width The number of tiles in the row
+ * \note The mine tiles are kept as is, the others get the number of mines around them as value
+ */
+typedef void (*NumberKernel)(const uint8_t *mines, int stride, uint8_t *tiles, int width);
+
+static void number_kernel_scalar(const uint8_t *mines, int stride, uint8_t *tiles, int width) {
+    for (int col = 0; col < width; col++) {
+        const uint8_t *up = mines + col;
+        const uint8_t *mid = up + stride;
+        const uint8_t *down = mid + stride;
+        uint8_t count = up[0] + up[1] + up[2] + mid[0] + mid[1] + mid[2] + down[0] + down[1] + down[2];
+        if (!mid[1]) {
+            tiles[col] = (uint8_t)((tiles[col] & 0b11000000) | count);
+        }
+    }
+}
+
+#ifdef NUMBERS_X86
+__attribute__((target("sse2")))
+static void number_kernel_sse2(const uint8_t *mines, int stride, uint8_t *tiles, int width) {
+    const __m128i state_mask = _mm_set1_epi8((char)0b11000000);
+    for (int col = 0; col < width; col += 16) {
+        __m128i count = _mm_setzero_si128();
+        for (int i = 0; i < 3; i++) {
+            const uint8_t *row = mines + i*stride + col;
+            count = _mm_add_epi8(count, _mm_loadu_si128((const __m128i *)row));
+            count = _mm_add_epi8(count, _mm_loadu_si128((const __m128i *)(row + 1)));
+            count = _mm_add_epi8(count, _mm_loadu_si128((const __m128i *)(row + 2)));
+        }
+        __m128i is_mine = _mm_cmpgt_epi8(_mm_loadu_si128((const __m128i *)(mines + stride + col + 1)), _mm_setzero_si128());
+        __m128i tile = _mm_loadu_si128((const __m128i *)(tiles + col));
+        __m128i number = _mm_or_si128(_mm_and_si128(tile, state_mask), count);
+        tile = _mm_or_si128(_mm_and_si128(is_mine, tile), _mm_andnot_si128(is_mine, number));
+        _mm_storeu_si128((__m128i *)(tiles + col), tile);
+    }
+}
+
+__attribute__((target("avx2")))
+static void number_kernel_avx2(const uint8_t *mines, int stride, uint8_t *tiles, int width) {
+    const __m256i state_mask = _mm256_set1_epi8((char)0b11000000);
+    for (int col = 0; col < width; col += 32) {
+        __m256i count = _mm256_setzero_si256();
+        for (int i = 0; i < 3; i++) {
+            const uint8_t *row = mines + i*stride + col;
+            count = _mm256_add_epi8(count, _mm256_loadu_si256((const __m256i *)row));
+            count = _mm256_add_epi8(count, _mm256_loadu_si256((const __m256i *)(row + 1)));
+            count = _mm256_add_epi8(count, _mm256_loadu_si256((const __m256i *)(row + 2)));
+        }
+        __m256i is_mine = _mm256_cmpgt_epi8(_mm256_loadu_si256((const __m256i *)(mines + stride + col + 1)), _mm256_setzero_si256());
+        __m256i tile = _mm256_loadu_si256((const __m256i *)(tiles + col));
+        __m256i number = _mm256_or_si256(_mm256_and_si256(tile, state_mask), count);
+        tile = _mm256_blendv_epi8(number, tile, is_mine);
+        _mm256_storeu_si256((__m256i *)(tiles + col), tile);
+    }
+}
+#endif
+
+static NumberKernel number_kernel = NULL; // Row kernel in use, NULL until picked
+
+/**
+ * Picks the row kernel of `gen_numbers`
+ * \param name The kernel, "scalar", "sse2" or "avx2", NULL for the best one the CPU supports
+ * \return False if the kernel is unknown or the CPU does not support it, the kernel is kept
+ */
+bool use_number_kernel(const char *name) {
+    NumberKernel kernel = NULL;
+    if (name == NULL || strcmp(name, "scalar") == 0) {
+        kernel = number_kernel_scalar;
+    }
+#ifdef NUMBERS_X86
+    __builtin_cpu_init();
+    if ((name == NULL || strcmp(name, "sse2") == 0) && __builtin_cpu_supports("sse2")) {
+        kernel = number_kernel_sse2;
+    }
+    if ((name == NULL || strcmp(name, "avx2") == 0) && __builtin_cpu_supports("avx2")) {
+        kernel = number_kernel_avx2;
+    }
+#endif
+    if (kernel == NULL) {
+        return false;
+    }
+    number_kernel = kernel;
+    return true;
+}
+
+/**
+ * Expands the mine bitplane of the grid into the halo-padded byte plane `game->mine_pad`
+ * \param game The game to get the mine bitplane from
+ * \param row0 The first row to fill
+ * \param col0 The first column to fill
+ * \param row1 The row after the last row to fill
+ * \param col1 The column after the last column to fill
+ * \note `mine_pad[(row+1)*pad_stride + col+1]` is 1 if the tile (`row`, `col`) is a mine. Only
+ * the chunks overlapping the area are expanded, the halo around it is filled too
+ */
+void fill_mine_pad(Game *game, int row0, int col0, int row1, int col1) {
+    row0 = row0 > 0 ? row0 - 1 : 0;
+    row1 = row1 < game->map_h ? row1 + 1 : game->map_h;
+    int ccol0 = col0 > 0 ? (col0 - 1) / CHUNK_WIDTH : 0;
+    int ccol1 = col1 < game->map_w ? col1 / CHUNK_WIDTH + 1 : game->size;
+    memset(&game->mine_pad[row0 * game->pad_stride], 0, (row1 - row0 + 2) * game->pad_stride);
+    for (int row = row0; row < row1; row++) {
+        for (int ccol = ccol0; ccol < ccol1; ccol++) {
+            uint64_t bits = get_chunk(game, row / CHUNK_HEIGHT, ccol)->planes.bits[P_MINE][row % CHUNK_HEIGHT];
+            uint8_t *pad = &game->mine_pad[(row + 1) * game->pad_stride + ccol*CHUNK_WIDTH + 1];
+            while (bits) {
+                pad[__builtin_ctzll(bits)] = 1;
+                bits &= bits - 1;
+            }
+        }
+    }
+}
+
+/**
+ * Copies a part of a grid row between the chunks and a buffer
+ * \param game The game to copy the row from/to
+ * \param row The row to copy
+ * \param col0 The first column to copy
+ * \param col1 The column after the last column to copy
+ * \param buffer The buffer, `buffer[0]` is the column `col0`
+ * \param to_grid True to copy the buffer to the grid, false to copy the grid to the buffer
+ */
+static void copy_grid_row(Game *game, int row, int col0, int col1, uint8_t *buffer, bool to_grid) {
+    while (col0 < col1) {
+        int end = (col0 / CHUNK_WIDTH + 1) * CHUNK_WIDTH;
+        end = end < col1 ? end : col1;
+        if (to_grid) {
+            memcpy(get_tile(game, row, col0), buffer, end - col0);
+        } else {
+            memcpy(buffer, get_tile(game, row, col0), end - col0);
+        }
+        buffer += end - col0;
+        col0 = end;
+    }
+}
+
+/**
+ * Generates the numbers in an area of the grid
+ * \param game The game to generate the numbers in
+ * \param row0 The first row of the area
+ * \param col0 The first column of the area
+ * \param row1 The row after the last row of the area
+ * \param col1 The column after the last column of the area
+ * \note The mines are counted from the mine bitplane, which must be up to date. The flags around
+ * the tiles are counted again, the 0 areas and the render targets of the chunks overlapping the area
+ * are marked as stale
+ */
+void gen_numbers_rect(Game *game, int row0, int col0, int row1, int col1) {
+    invalidate_zero_components(game, row0, col0, row1, col1);
+    invalidate_render_rect(game, row0, col0, row1, col1);
+    count_flags_rect(game, row0, col0, row1, col1);
+    fill_mine_pad(game, row0, col0, row1, col1);
+    if (number_kernel == NULL) {
+        use_number_kernel(NULL);
+    }
+    uint8_t tiles[game->pad_stride];
+    memset(tiles, 0, game->pad_stride);
+    for (int row = row0; row < row1; row++) {
+        copy_grid_row(game, row, col0, col1, tiles, false);
+        number_kernel(&game->mine_pad[row * game->pad_stride + col0], game->pad_stride, tiles, col1 - col0);
+        copy_grid_row(game, row, col0, col1, tiles, true);
+    }
+}
+
+/**
+ * Generates the numbers in the grid
+ * \param game The game to generate the numbers in
+ */
+void gen_numbers(Game *game) {
+    gen_numbers_rect(game, 0, 0, game->map_h, game->map_w);
+}
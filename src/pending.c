@@ -0,0 +1,384 @@
+#include "game.h"
+
+#define PENDING_REGION_SIZE 32 // Chunks on each side of the area of a pending reveals file
+#define PENDING_RECORD_SIZE (2 * sizeof(int) + CHUNK_HEIGHT * sizeof(uint64_t)) // Chunk coordinates and tiles
+
+/**
+ * Gets the slot of a chunk in the pending reveals table
+ * \param game The game the table is in
+ * \param crow The row of the chunk
+ * \param ccol The column of the chunk
+ * \return The slot of the entry of the chunk, or the free slot to add it in
+ * \note The table is open addressing with linear probing, it always has a free slot
+ */
+static int pending_slot(Game *game, int crow, int ccol) {
+    uint32_t mask = game->pending_capacity - 1;
+    uint32_t slot = (uint32_t)mix64((uint64_t)(uint32_t)crow << 32 | (uint32_t)ccol) & mask;
+    while (game->pending[slot].used && (game->pending[slot].crow != crow || game->pending[slot].ccol != ccol)) {
+        slot = (slot + 1) & mask;
+    }
+    return (int)slot;
+}
+
+/**
+ * Resizes the pending reveals table, the entries are added again
+ * \param game The game to resize the table of
+ * \param capacity The new size of the table, a power of 2 larger than the number of entries
+ * \param drop_empty True to drop the saved entries without tiles
+ */
+static void resize_pending(Game *game, int capacity, bool drop_empty) {
+    PendingReveal *entries = game->pending;
+    int old_capacity = game->pending_capacity;
+    game->pending = (PendingReveal *)calloc(capacity, sizeof(PendingReveal));
+    if (game->pending == NULL) {
+        fprintf(stderr, "Error allocating the pending reveals\n");
+        exit(1);
+    }
+    game->pending_capacity = capacity;
+    game->pending_count = 0;
+    for (int i = 0; i < old_capacity; i++) {
+        if (!entries[i].used) {
+            continue;
+        }
+        bool empty = true;
+        for (int r = 0; r < CHUNK_HEIGHT && empty; r++) {
+            empty = entries[i].rows[r] == 0;
+        }
+        if (drop_empty && empty && !entries[i].unsaved) {
+            continue;
+        }
+        game->pending[pending_slot(game, entries[i].crow, entries[i].ccol)] = entries[i];
+        game->pending_count++;
+    }
+    free(entries);
+}
+
+/**
+ * Gets the pending reveals of a chunk
+ * \param game The game the chunk is in
+ * \param crow The row of the chunk
+ * \param ccol The column of the chunk
+ * \param add True to add an entry without tiles if the chunk has none
+ * \return The entry of the chunk, NULL if it has none and none is added
+ * \note Adding an entry may move the others, the pointers to them are not valid anymore
+ */
+static PendingReveal *get_pending(Game *game, int crow, int ccol, bool add) {
+    if (game->pending_capacity == 0) {
+        if (!add) {
+            return NULL;
+        }
+        resize_pending(game, 64, false);
+    }
+    PendingReveal *entry = &game->pending[pending_slot(game, crow, ccol)];
+    if (entry->used || !add) {
+        return entry->used ? entry : NULL;
+    }
+    // The table is kept at most 3/4 full
+    if ((game->pending_count + 1) * 4 > game->pending_capacity * 3) {
+        resize_pending(game, game->pending_capacity * 2, false);
+        entry = &game->pending[pending_slot(game, crow, ccol)];
+    }
+    memset(entry, 0, sizeof(PendingReveal));
+    entry->used = true;
+    entry->crow = crow;
+    entry->ccol = ccol;
+    game->pending_count++;
+    return entry;
+}
+
+/**
+ * Drops every pending reveal, without changing their files
+ * \param game The game to drop the pending reveals of
+ */
+void clear_pending_reveals(Game *game) {
+    if (game->pending_capacity > 0) {
+        memset(game->pending, 0, game->pending_capacity * sizeof(PendingReveal));
+    }
+    game->pending_count = 0;
+}
+
+/**
+ * Queues a tile out of the grid to be revealed when its chunk is loaded
+ * \param game The game to queue the tile in
+ * \param row The row of the tile, relative to the grid (may be out of it)
+ * \param col The column of the tile, relative to the grid (may be out of it)
+ */
+void queue_pending_reveal(Game *game, int row, int col) {
+    int grid_crow = (int)floor((double)row / CHUNK_HEIGHT);
+    int grid_ccol = (int)floor((double)col / CHUNK_WIDTH);
+    int crow = game->cy - game->radius + grid_crow;
+    int ccol = game->cx - game->radius + grid_ccol;
+    row -= grid_crow * CHUNK_HEIGHT;
+    col -= grid_ccol * CHUNK_WIDTH;
+
+    PendingReveal *entry = get_pending(game, crow, ccol, true);
+    if (!((entry->rows[row] >> col) & 1)) {
+        entry->rows[row] |= 1ULL << col;
+        entry->unsaved = true;
+    }
+}
+
+/**
+ * Queues the tiles out of the grid around the 0 area being revealed
+ * \param game The game to queue the tiles in
+ * \note The area is read from `game->zero_area`, only its tiles on the edges of the grid have
+ * neighbours out of it
+ */
+void queue_area_edges(Game *game) {
+    int size = game->size;
+    for (int k = 0; k < size; k++) {
+        uint64_t *top = &game->zero_area[k * CHUNK_HEIGHT];
+        uint64_t *bottom = &game->zero_area[((size - 1) * size + k) * CHUNK_HEIGHT];
+        for (uint64_t bits = top[0]; bits; bits &= bits - 1) {
+            int col = k * CHUNK_WIDTH + __builtin_ctzll(bits);
+            for (int j = col - 1; j <= col + 1; j++) queue_pending_reveal(game, -1, j);
+        }
+        for (uint64_t bits = bottom[CHUNK_HEIGHT - 1]; bits; bits &= bits - 1) {
+            int col = k * CHUNK_WIDTH + __builtin_ctzll(bits);
+            for (int j = col - 1; j <= col + 1; j++) queue_pending_reveal(game, game->map_h, j);
+        }
+        uint64_t *left = &game->zero_area[k * size * CHUNK_HEIGHT];
+        uint64_t *right = &game->zero_area[(k * size + size - 1) * CHUNK_HEIGHT];
+        for (int r = 0; r < CHUNK_HEIGHT; r++) {
+            int row = k * CHUNK_HEIGHT + r;
+            if (left[r] & 1) {
+                for (int i = row - 1; i <= row + 1; i++) queue_pending_reveal(game, i, -1);
+            }
+            if ((right[r] >> (CHUNK_WIDTH - 1)) & 1) {
+                for (int i = row - 1; i <= row + 1; i++) queue_pending_reveal(game, i, game->map_w);
+            }
+        }
+    }
+}
+
+/**
+ * Checks if a pending tile continues a 0 area, from the tiles around it in the grid
+ * \param game The game the tile is in
+ * \param row The row of the tile
+ * \param col The column of the tile
+ * \return 1 if a tile around it is a revealed 0, 0 if none is, -1 if it can't be known yet
+ * \note The number of a tile is only known if its neighbours are in the grid, a 0 on the edge of
+ * the grid may have a mine out of it. The chunk loaded may differ from the one the tile was queued
+ * against (saved or cached since), so the area is checked again against the loaded chunks
+ */
+static int pending_source(Game *game, int row, int col) {
+    int known = 1;
+    for (int i = row - 1; i <= row + 1; i++) {
+        for (int j = col - 1; j <= col + 1; j++) {
+            if (i == row && j == col) {
+                continue;
+            }
+            if (!in_grid(game, i, j)) {
+                known = 0;
+                continue;
+            }
+            uint8_t value, state;
+            get_tile_info(*get_tile(game, i, j), &value, &state);
+            if (state == REVEALED && value == 0) {
+                if (i > 0 && i < game->map_h - 1 && j > 0 && j < game->map_w - 1) {
+                    return 1;
+                }
+                known = 0;
+            }
+        }
+    }
+    return known ? 0 : -1;
+}
+
+/**
+ * Reveals the pending tiles of the loaded chunks next to a revealed 0
+ * \param game The game to reveal the tiles in
+ * \note The revealed 0 continue their area, which may queue tiles further out. The tiles without
+ * a revealed 0 around them are dropped, or kept if the tiles around them are not all known yet
+ */
+void drain_pending_reveals(Game *game) {
+    for (int crow = 0; crow < game->size; crow++) {
+        for (int ccol = 0; ccol < game->size; ccol++) {
+            PendingReveal *entry = get_pending(game, game->cy - game->radius + crow, game->cx - game->radius + ccol, false);
+            if (entry == NULL) {
+                continue;
+            }
+            // The entry may move while the tiles are revealed, its tiles are taken out first and
+            // the undecided ones are queued again
+            uint64_t rows[CHUNK_HEIGHT];
+            bool any = false;
+            for (int r = 0; r < CHUNK_HEIGHT; r++) {
+                rows[r] = entry->rows[r];
+                any |= rows[r] != 0;
+                entry->rows[r] = 0;
+            }
+            if (!any) {
+                continue;
+            }
+            entry->unsaved = true;
+            for (int r = 0; r < CHUNK_HEIGHT; r++) {
+                for (uint64_t bits = rows[r]; bits; bits &= bits - 1) {
+                    int row = crow * CHUNK_HEIGHT + r;
+                    int col = ccol * CHUNK_WIDTH + __builtin_ctzll(bits);
+                    uint8_t value, state;
+                    get_tile_info(*get_tile(game, row, col), &value, &state);
+                    if (state != HIDDEN || value == 9) {
+                        continue;
+                    }
+                    int source = pending_source(game, row, col);
+                    if (source == 1) {
+                        game->score += reveal_area(game, row, col);
+                    } else if (source == -1) {
+                        queue_pending_reveal(game, row, col);
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Gets the coordinates of the pending reveals file of a chunk
+ */
+static void pending_region(int crow, int ccol, int *rrow, int *rcol) {
+    *rrow = (int)floor((double)crow / PENDING_REGION_SIZE);
+    *rcol = (int)floor((double)ccol / PENDING_REGION_SIZE);
+}
+
+/**
+ * Writes the pending reveals file of a region, `saves/p.<row>.<col>.msav`, with the entries of its
+ * chunks. The file is deleted if they have no tiles
+ * \param game The game to save the pending reveals of
+ * \param rrow The row of the region
+ * \param rcol The column of the region
+ */
+static void save_pending_region(Game *game, int rrow, int rcol) {
+    int count = 0;
+    for (int i = 0; i < game->pending_capacity; i++) {
+        PendingReveal *entry = &game->pending[i];
+        int erow, ecol;
+        pending_region(entry->crow, entry->ccol, &erow, &ecol);
+        if (!entry->used || erow != rrow || ecol != rcol) {
+            continue;
+        }
+        entry->unsaved = false;
+        for (int r = 0; r < CHUNK_HEIGHT; r++) {
+            if (entry->rows[r] != 0) {
+                count++;
+                break;
+            }
+        }
+    }
+
+    char filename[50];
+    snprintf(filename, sizeof filename, "saves/p.%d.%d.msav", rrow, rcol);
+    if (count == 0) {
+        remove(filename);
+        return;
+    }
+    FILE *file = fopen(filename, "wb");
+    if (file == NULL) {
+        fprintf(stderr, "Error opening file %s\n", filename);
+        exit(1);
+    }
+    fwrite(&count, sizeof(int), 1, file);
+    for (int i = 0; i < game->pending_capacity; i++) {
+        PendingReveal *entry = &game->pending[i];
+        int erow, ecol;
+        pending_region(entry->crow, entry->ccol, &erow, &ecol);
+        bool empty = true;
+        for (int r = 0; r < CHUNK_HEIGHT && empty; r++) {
+            empty = entry->rows[r] == 0;
+        }
+        if (entry->used && !empty && erow == rrow && ecol == rcol) {
+            fwrite(&entry->crow, sizeof(int), 1, file);
+            fwrite(&entry->ccol, sizeof(int), 1, file);
+            fwrite(entry->rows, sizeof(uint64_t), CHUNK_HEIGHT, file);
+        }
+    }
+    fclose(file);
+    game->write_volume += sizeof(int) + count * PENDING_RECORD_SIZE;
+}
+
+/**
+ * Saves the pending reveals that changed since they were last saved
+ * \param game The game to save the pending reveals of
+ * \note The pending reveals are saved in a file per region of PENDING_REGION_SIZE x PENDING_REGION_SIZE
+ * chunks, only the files of the changed entries are written. The entries without tiles are dropped
+ */
+void save_pending_reveals(Game *game) {
+    bool changed = false;
+    for (int i = 0; i < game->pending_capacity; i++) {
+        if (game->pending[i].used && game->pending[i].unsaved) {
+            int rrow, rcol;
+            pending_region(game->pending[i].crow, game->pending[i].ccol, &rrow, &rcol);
+            save_pending_region(game, rrow, rcol);
+            changed = true;
+        }
+    }
+    if (changed) {
+        resize_pending(game, game->pending_capacity, true);
+    }
+}
+
+/**
+ * Reads a pending reveals file to the table
+ * \param game The game to load the pending reveals to
+ * \param filename The path to the file
+ * \param unsaved True to mark the entries read as changed since they were saved
+ * \note A truncated or corrupt file is read up to its last complete entry
+ */
+static void read_pending_file(Game *game, const char *filename, bool unsaved) {
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL) {
+        return;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    int count = 0;
+    if (fread(&count, sizeof(int), 1, file) != 1 || count < 0 || (long)(size - sizeof(int)) / (long)PENDING_RECORD_SIZE < count) {
+        fclose(file);
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        int crow, ccol;
+        uint64_t rows[CHUNK_HEIGHT];
+        if (fread(&crow, sizeof(int), 1, file) != 1 || fread(&ccol, sizeof(int), 1, file) != 1
+            || fread(rows, sizeof(uint64_t), CHUNK_HEIGHT, file) != CHUNK_HEIGHT) {
+            break;
+        }
+        PendingReveal *entry = get_pending(game, crow, ccol, true);
+        for (int r = 0; r < CHUNK_HEIGHT; r++) {
+            entry->rows[r] |= rows[r] & ((1ULL << CHUNK_WIDTH) - 1);
+        }
+        entry->unsaved |= unsaved;
+    }
+    fclose(file);
+}
+
+/**
+ * Loads the pending reveals, none if the save has no pending reveals
+ * \param game The game to load the pending reveals to
+ * \note The single `saves/pending.msav` of the older saves holds the same entries, they are moved
+ * to the region files with the next save
+ */
+void load_pending_reveals(Game *game) {
+    clear_pending_reveals(game);
+    DIR *dir = opendir("saves");
+    if (dir == NULL) {
+        return;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        int rrow, rcol, length = 0;
+        if (sscanf(entry->d_name, "p.%d.%d.msav%n", &rrow, &rcol, &length) != 2 || length == 0 || entry->d_name[length] != '\0') {
+            continue;
+        }
+        char filename[300];
+        snprintf(filename, sizeof filename, "saves/%s", entry->d_name);
+        read_pending_file(game, filename, false);
+    }
+    closedir(dir);
+
+    if (file_exists("saves/pending.msav")) {
+        read_pending_file(game, "saves/pending.msav", true);
+        save_pending_reveals(game);
+        remove("saves/pending.msav");
+    }
+}
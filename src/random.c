@@ -0,0 +1,58 @@
+#include "game.h"
+
+/**
+ * Mixes the bits of a 64-bit value (SplitMix64 finalizer)
+ * \param z The value to mix
+ * \return The mixed value
+ */
+uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * Gets the next random number of a SplitMix64 generator
+ * \param state The state of the generator
+ * \return A random 64-bit number
+ */
+uint64_t next_random(uint64_t *state) {
+    *state += 0x9E3779B97F4A7C15ULL;
+    return mix64(*state);
+}
+
+/**
+ * Gets a random number below a bound
+ * \param state The state of the generator
+ * \param bound The bound, must be > 0
+ * \return A random number in [0, bound)
+ */
+uint32_t random_below(uint64_t *state, uint32_t bound) {
+    return (uint32_t)(((next_random(state) >> 32) * bound) >> 32);
+}
+
+/**
+ * Gets the generator state of a chunk
+ * \param seed The world seed
+ * \param row The row of the chunk
+ * \param col The column of the chunk
+ * \return A state that only depends on the seed and the chunk coordinates, so a chunk can be
+ * generated again at any time
+ */
+uint64_t chunk_seed(uint64_t seed, int row, int col) {
+    uint64_t key = (uint64_t)(uint32_t)row << 32 | (uint32_t)col;
+    return mix64(seed ^ mix64(key));
+}
+
+/**
+ * Generates a new world seed
+ * \return The seed
+ * \note `rand` must have been seeded
+ */
+uint64_t gen_seed() {
+    uint64_t seed = (uint64_t)time(NULL);
+    for (int i = 0; i < 4; i++) {
+        seed = (seed << 16) ^ (uint64_t)rand();
+    }
+    return mix64(seed);
+}
@@ -0,0 +1,377 @@
+#include "game.h"
+
+#include <SDL2/SDL_mutex.h>
+
+#define REGION_SIZE 32 // Chunks on each side of a region
+#define REGION_HANDLES 8 // Region files kept open, more than the threads using them
+#define REGION_MISSING 64 // Regions known to have no file, a chunk load does not try to open them again
+#define REGION_HEADER (REGION_SIZE * REGION_SIZE * sizeof(uint32_t))
+#define CHUNK_BYTES (CHUNK_HEIGHT * CHUNK_WIDTH)
+
+/**
+ * Open region file, a region groups REGION_SIZE x REGION_SIZE chunks in `saves/r.<row>.<col>.msav`.
+ * The file starts with a table of the slots of its chunks (slot + 1, 0 if the chunk is not saved),
+ * the chunks follow in the order they were first saved and are rewritten in place
+ */
+typedef struct _Region {
+    FILE *file; // NULL if the handle is free or opening
+    SDL_mutex *lock; // Serializes the reads and writes of the file, held without the table lock
+    bool opening; // The file is being opened without the table lock, the handle is reserved for it
+    int users; // Threads reading or writing the file, the handle is not closed while it has users
+    int rrow, rcol; // Region coordinates
+    uint32_t last_use; // Tick of the last access, the lowest one is closed first
+    uint32_t slots[REGION_SIZE * REGION_SIZE];
+    uint32_t slot_count; // Slots of the file, including the ones still being written
+} Region;
+
+static Region regions[REGION_HANDLES];
+static uint32_t region_tick;
+static SDL_mutex *region_mutex; // Protects the handles and their slot tables, never held during a chunk read or write
+static SDL_cond *region_released; // Signaled when a handle has no users anymore or is opened
+static int missing_regions[REGION_MISSING][2]; // Region coordinates, protected by the table lock
+static int missing_count;
+static int missing_next; // Entry replaced when the table is full
+
+/**
+ * Prepares the region files, must be called before any chunk is saved or loaded
+ */
+void open_regions() {
+    region_mutex = SDL_CreateMutex();
+    region_released = SDL_CreateCond();
+    if (region_mutex == NULL || region_released == NULL) {
+        fprintf(stderr, "Error creating the region locks: %s\n", SDL_GetError());
+        exit(1);
+    }
+    for (int i = 0; i < REGION_HANDLES; i++) {
+        regions[i].lock = SDL_CreateMutex();
+        if (regions[i].lock == NULL) {
+            fprintf(stderr, "Error creating the region locks: %s\n", SDL_GetError());
+            exit(1);
+        }
+    }
+}
+
+/**
+ * Closes the open region files, waits for their users first
+ * \note The region lock must be held
+ */
+static void close_region_files() {
+    for (int i = 0; i < REGION_HANDLES; i++) {
+        while (regions[i].users > 0) {
+            SDL_CondWait(region_released, region_mutex);
+        }
+        if (regions[i].file != NULL) {
+            fclose(regions[i].file);
+            regions[i].file = NULL;
+        }
+    }
+}
+
+/**
+ * Closes the region files, must be called after the workers are stopped
+ */
+void close_regions() {
+    SDL_LockMutex(region_mutex);
+    close_region_files();
+    SDL_UnlockMutex(region_mutex);
+    for (int i = 0; i < REGION_HANDLES; i++) {
+        SDL_DestroyMutex(regions[i].lock);
+        regions[i].lock = NULL;
+    }
+    SDL_DestroyCond(region_released);
+    SDL_DestroyMutex(region_mutex);
+    region_released = NULL;
+    region_mutex = NULL;
+    missing_count = 0;
+    missing_next = 0;
+}
+
+/**
+ * Deletes the region files
+ * \note The files are closed and removed under the lock, the workers can't open them meanwhile
+ */
+void delete_regions() {
+    SDL_LockMutex(region_mutex);
+    close_region_files();
+    DIR *dir = opendir("saves");
+    if (dir != NULL) {
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            int rrow, rcol, length = 0;
+            if (sscanf(entry->d_name, "r.%d.%d.msav%n", &rrow, &rcol, &length) != 2 || length == 0 || entry->d_name[length] != '\0') {
+                continue;
+            }
+            char filename[300];
+            sprintf(filename, "saves/%s", entry->d_name);
+            if (remove(filename) != 0) {
+                fprintf(stderr, "Error deleting file %s\n", filename);
+                exit(1);
+            }
+        }
+        closedir(dir);
+    }
+    SDL_UnlockMutex(region_mutex);
+}
+
+/**
+ * Finds a region in the regions known to have no file
+ * \return The index of the region in `missing_regions`, -1 if it is not known to be missing
+ * \note The region lock must be held
+ */
+static int find_missing_region(int rrow, int rcol) {
+    for (int i = 0; i < missing_count; i++) {
+        if (missing_regions[i][0] == rrow && missing_regions[i][1] == rcol) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Marks a region as having no file, or as having one
+ * \param rrow The row of the region
+ * \param rcol The column of the region
+ * \param missing True if the region has no file
+ * \note The region lock must be held
+ */
+static void set_region_missing(int rrow, int rcol, bool missing) {
+    int index = find_missing_region(rrow, rcol);
+    if (!missing) {
+        if (index != -1) {
+            missing_count--;
+            missing_regions[index][0] = missing_regions[missing_count][0];
+            missing_regions[index][1] = missing_regions[missing_count][1];
+        }
+        return;
+    }
+    if (index != -1) {
+        return;
+    }
+    if (missing_count < REGION_MISSING) {
+        index = missing_count++;
+    } else {
+        index = missing_next;
+        missing_next = (missing_next + 1) % REGION_MISSING;
+    }
+    missing_regions[index][0] = rrow;
+    missing_regions[index][1] = rcol;
+}
+
+/**
+ * Gets the open region file of a chunk and adds a user to it, opens the file if needed
+ * \param crow The row of the chunk
+ * \param ccol The column of the chunk
+ * \param create True to create the file if it does not exist
+ * \return The region, NULL if it does not exist and is not created
+ * \note The region lock must be held. It is released while a file is opened, the handle is
+ * reserved meanwhile. The least recently used handle without users is reused, the call waits for
+ * one if they all have users. A region known to have no file is not opened again to load a chunk
+ */
+static Region *get_region(int crow, int ccol, bool create) {
+    int rrow = (int)floor((double)crow / REGION_SIZE);
+    int rcol = (int)floor((double)ccol / REGION_SIZE);
+    Region *region = NULL;
+    while (region == NULL) {
+        bool opening = false;
+        for (int i = 0; i < REGION_HANDLES && !opening; i++) {
+            if ((regions[i].file != NULL || regions[i].opening) && regions[i].rrow == rrow && regions[i].rcol == rcol) {
+                if (!regions[i].opening) {
+                    regions[i].last_use = ++region_tick;
+                    regions[i].users++;
+                    return &regions[i];
+                }
+                opening = true;
+            }
+        }
+        if (!opening && !create && find_missing_region(rrow, rcol) != -1) {
+            return NULL;
+        }
+        for (int i = 0; i < REGION_HANDLES && !opening; i++) {
+            if (regions[i].users == 0 && (region == NULL || (region->file != NULL && (regions[i].file == NULL || regions[i].last_use < region->last_use)))) {
+                region = &regions[i];
+            }
+        }
+        if (region == NULL) {
+            // The table may have changed while waiting, the file is searched again
+            SDL_CondWait(region_released, region_mutex);
+        }
+    }
+
+    // The handle is reserved, the file is opened and its table read without the lock
+    FILE *old = region->file;
+    region->file = NULL;
+    region->opening = true;
+    region->users = 1;
+    region->rrow = rrow;
+    region->rcol = rcol;
+    SDL_UnlockMutex(region_mutex);
+
+    if (old != NULL) {
+        fclose(old);
+    }
+    char filename[50];
+    sprintf(filename, "saves/r.%d.%d.msav", rrow, rcol);
+    memset(region->slots, 0, sizeof(region->slots));
+    region->slot_count = 0;
+    FILE *file = fopen(filename, "r+b");
+    if (file != NULL) {
+        if (fread(region->slots, 1, REGION_HEADER, file) != REGION_HEADER) {
+            fprintf(stderr, "Error reading file %s\n", filename);
+            exit(1);
+        }
+        for (int i = 0; i < REGION_SIZE * REGION_SIZE; i++) {
+            if (region->slots[i] > region->slot_count) {
+                region->slot_count = region->slots[i];
+            }
+        }
+    } else if (create) {
+        file = fopen(filename, "w+b");
+        if (file == NULL) {
+            fprintf(stderr, "Error opening file %s\n", filename);
+            exit(1);
+        }
+        fwrite(region->slots, 1, REGION_HEADER, file);
+    }
+
+    SDL_LockMutex(region_mutex);
+    region->opening = false;
+    SDL_CondBroadcast(region_released);
+    set_region_missing(rrow, rcol, file == NULL);
+    if (file == NULL) {
+        region->users = 0;
+        return NULL;
+    }
+    region->file = file;
+    region->last_use = ++region_tick;
+    return region;
+}
+
+/**
+ * Gives back a region handle taken with `get_region`
+ * \param region The region to release
+ * \note The region lock must be held
+ */
+static void release_region_locked(Region *region) {
+    if (--region->users == 0) {
+        SDL_CondBroadcast(region_released);
+    }
+}
+
+/**
+ * Gives back a region handle taken with `get_region`
+ * \param region The region to release
+ */
+static void release_region(Region *region) {
+    SDL_LockMutex(region_mutex);
+    release_region_locked(region);
+    SDL_UnlockMutex(region_mutex);
+}
+
+/**
+ * Gets the index of a chunk in the slot table of its region
+ */
+static int region_index(int crow, int ccol) {
+    int row = crow % REGION_SIZE, col = ccol % REGION_SIZE;
+    return (row < 0 ? row + REGION_SIZE : row) * REGION_SIZE + (col < 0 ? col + REGION_SIZE : col);
+}
+
+/**
+ * Saves a single chunk in its region file
+ * \param chunk The chunk to save
+ * \param row The row of the chunk
+ * \param col The column of the chunk
+ * \note A chunk must not be saved by two threads at once. The table lock is only held to find the
+ * slot, the file is written under the lock of its handle
+ */
+void save_chunk(uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH], int row, int col) {
+    int index = region_index(row, col);
+    SDL_LockMutex(region_mutex);
+    Region *region = get_region(row, col, true);
+    uint32_t slot = region->slots[index];
+    bool added = slot == 0;
+    if (added) {
+        slot = ++region->slot_count;
+    }
+    SDL_UnlockMutex(region_mutex);
+
+    // The chunk is written before the table points to it
+    SDL_LockMutex(region->lock);
+    fseek(region->file, REGION_HEADER + (long)(slot - 1) * CHUNK_BYTES, SEEK_SET);
+    fwrite(chunk, 1, CHUNK_BYTES, region->file);
+    if (added) {
+        fseek(region->file, index * sizeof(uint32_t), SEEK_SET);
+        fwrite(&slot, sizeof(uint32_t), 1, region->file);
+    }
+    fflush(region->file);
+    SDL_UnlockMutex(region->lock);
+
+    if (added) {
+        SDL_LockMutex(region_mutex);
+        region->slots[index] = slot;
+        SDL_UnlockMutex(region_mutex);
+    }
+    release_region(region);
+}
+
+/**
+ * Loads a single chunk from its region file
+ * \param chunk The chunk to load
+ * \param row The row of the chunk
+ * \param col The column of the chunk
+ * \return True if the chunk was saved, false leaves the chunk as it is
+ * \note Only waits for the chunk reads and writes of the same region file
+ */
+bool load_chunk(uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH], int row, int col) {
+    SDL_LockMutex(region_mutex);
+    Region *region = get_region(row, col, false);
+    uint32_t slot = region != NULL ? region->slots[region_index(row, col)] : 0;
+    if (slot == 0) {
+        if (region != NULL) {
+            release_region_locked(region);
+        }
+        SDL_UnlockMutex(region_mutex);
+        return false;
+    }
+    SDL_UnlockMutex(region_mutex);
+
+    SDL_LockMutex(region->lock);
+    fseek(region->file, REGION_HEADER + (long)(slot - 1) * CHUNK_BYTES, SEEK_SET);
+    bool saved = fread(chunk, 1, CHUNK_BYTES, region->file) == CHUNK_BYTES;
+    SDL_UnlockMutex(region->lock);
+    release_region(region);
+    return saved;
+}
+
+/**
+ * Moves the chunks saved one file per chunk (`saves/<row>.<col>.msav`) to the region files
+ * \note Must be called before the chunks are loaded
+ */
+void migrate_chunk_files() {
+    DIR *dir = opendir("saves");
+    if (dir == NULL) {
+        return;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        int row, col, length = 0;
+        if (sscanf(entry->d_name, "%d.%d.msav%n", &row, &col, &length) != 2 || length == 0 || entry->d_name[length] != '\0') {
+            continue;
+        }
+        char filename[300];
+        sprintf(filename, "saves/%s", entry->d_name);
+        FILE *file = fopen(filename, "rb");
+        uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH];
+        bool complete = file != NULL && fread(chunk, 1, CHUNK_BYTES, file) == CHUNK_BYTES;
+        if (file != NULL) {
+            fclose(file);
+        }
+        if (complete) {
+            save_chunk(chunk, row, col);
+        }
+        if (remove(filename) != 0) {
+            fprintf(stderr, "Error deleting file %s\n", filename);
+            exit(1);
+        }
+    }
+    closedir(dir);
+}
@@ -0,0 +1,237 @@
+#define SSGE_GET_SDL
+#include "game.h"
+#include "SSGE/SSGE_local.h"
+
+/**
+ * Position of the textures in the tiles atlas (row, column), indexed as `_textures` and the number
+ * textures that follow them, as loaded by `init_assets`
+ */
+static const uint8_t atlas_tiles[NUMBER_TILE_OFFSET + 9][2] = {
+    {2, 0}, {2, 1}, {2, 2}, {2, 3}, {3, 0}, {3, 3}, // hidden, mine, flag, wrong, bad flag, background
+    {0, 0}, {0, 1}, {0, 2}, {0, 3}, {1, 0}, {1, 1}, {1, 2}, {1, 3} // 1 - 8
+};
+
+struct _TileRenderer {
+    SSGE_Tilemap *atlas;
+    float atlas_w, atlas_h; // Size of the atlas texture
+    SDL_Vertex *vertices; // 4 vertices per tile
+    int *indices; // 6 indices per tile, two triangles
+    int capacity; // Number of tiles the buffers can hold
+    SDL_Texture **targets; // Render target of each chunk buffer, they follow the buffers across shifts
+    uint32_t target_generation; // Generation of the chunk buffers the targets were created for
+    int target_count;
+};
+
+/**
+ * Creates the tile renderer
+ * \param game The game to create the renderer for
+ * \param atlas The tilemap of the tiles textures, owned by the renderer
+ */
+void init_tile_renderer(Game *game, SSGE_Tilemap *atlas) {
+    TileRenderer *renderer = (TileRenderer *)calloc(1, sizeof(TileRenderer));
+    if (renderer == NULL) {
+        fprintf(stderr, "Error allocating the tile renderer\n");
+        exit(1);
+    }
+    int width, height;
+    SDL_QueryTexture(atlas->texture, NULL, NULL, &width, &height);
+    renderer->atlas = atlas;
+    renderer->atlas_w = (float)width;
+    renderer->atlas_h = (float)height;
+    game->renderer = renderer;
+}
+
+/**
+ * Destroys the render targets of the chunks
+ * \param renderer The renderer to destroy the targets of
+ */
+static void free_chunk_targets(TileRenderer *renderer) {
+    for (int i = 0; i < renderer->target_count; i++) {
+        SDL_DestroyTexture(renderer->targets[i]);
+    }
+    free(renderer->targets);
+    renderer->targets = NULL;
+    renderer->target_count = 0;
+}
+
+/**
+ * Creates the render targets of the chunks if the chunk buffers were allocated again
+ * \param game The game to create the targets for
+ */
+static void alloc_chunk_targets(Game *game) {
+    TileRenderer *renderer = game->renderer;
+    int count = game->size * game->size;
+    if (renderer->targets != NULL && renderer->target_generation == game->chunk_generation) {
+        return;
+    }
+    free_chunk_targets(renderer);
+    renderer->targets = (SDL_Texture **)malloc(count * sizeof(SDL_Texture *));
+    if (renderer->targets == NULL) {
+        fprintf(stderr, "Error allocating the chunk render targets\n");
+        exit(1);
+    }
+    for (int i = 0; i < count; i++) {
+        renderer->targets[i] = SDL_CreateTexture(_engine->renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, CHUNK_PX_WIDTH, CHUNK_PX_HEIGHT);
+        if (renderer->targets[i] == NULL) {
+            fprintf(stderr, "Error creating the chunk render targets: %s\n", SDL_GetError());
+            exit(1);
+        }
+        game->chunk_buffers[i].dirty = true;
+    }
+    renderer->target_generation = game->chunk_generation;
+    renderer->target_count = count;
+}
+
+/**
+ * Marks the chunks overlapping an area of the grid to be drawn again
+ * \param game The game to mark the chunks of
+ * \param row0 The first row of the area
+ * \param col0 The first column of the area
+ * \param row1 The row after the last row of the area
+ * \param col1 The column after the last column of the area
+ */
+void invalidate_render_rect(Game *game, int row0, int col0, int row1, int col1) {
+    for (int crow = row0 / CHUNK_HEIGHT; crow <= (row1 - 1) / CHUNK_HEIGHT; crow++) {
+        for (int ccol = col0 / CHUNK_WIDTH; ccol <= (col1 - 1) / CHUNK_WIDTH; ccol++) {
+            get_chunk(game, crow, ccol)->dirty = true;
+        }
+    }
+}
+
+/**
+ * Draws every chunk again after the contents of the render targets were lost
+ * \param game The game to draw the chunks of
+ * \param device_lost True if the renderer device was reset, the targets are created again
+ * \note Must be called on `SDL_RENDER_TARGETS_RESET` and `SDL_RENDER_DEVICE_RESET`
+ */
+void reset_render_targets(Game *game, bool device_lost) {
+    TileRenderer *renderer = game->renderer;
+    if (device_lost) {
+        free_chunk_targets(renderer);
+    }
+    for (int i = 0; i < game->size * game->size; i++) {
+        game->chunk_buffers[i].dirty = true;
+    }
+}
+
+/**
+ * Destroys the tile renderer
+ * \param game The game to destroy the renderer of
+ */
+void free_tile_renderer(Game *game) {
+    TileRenderer *renderer = game->renderer;
+    if (renderer == NULL) {
+        return;
+    }
+    SSGE_DestroyTilemap(renderer->atlas);
+    free_chunk_targets(renderer);
+    free(renderer->vertices);
+    free(renderer->indices);
+    free(renderer);
+    game->renderer = NULL;
+}
+
+/**
+ * Grows the vertex and index buffers of the renderer
+ * \param renderer The renderer to grow the buffers of
+ * \param count The number of tiles the buffers must hold
+ */
+static void reserve_tiles(TileRenderer *renderer, int count) {
+    if (count <= renderer->capacity) {
+        return;
+    }
+    renderer->vertices = (SDL_Vertex *)realloc(renderer->vertices, count * 4 * sizeof(SDL_Vertex));
+    renderer->indices = (int *)realloc(renderer->indices, count * 6 * sizeof(int));
+    if (renderer->vertices == NULL || renderer->indices == NULL) {
+        fprintf(stderr, "Error allocating the tile renderer buffers\n");
+        exit(1);
+    }
+    // The indices and colors never change, only the positions and texture coordinates do
+    for (int i = 0; i < count; i++) {
+        int *quad = &renderer->indices[i * 6];
+        quad[0] = i*4; quad[1] = i*4 + 1; quad[2] = i*4 + 2;
+        quad[3] = i*4 + 2; quad[4] = i*4 + 3; quad[5] = i*4;
+        for (int j = 0; j < 4; j++) {
+            renderer->vertices[i*4 + j].color = (SDL_Color){255, 255, 255, 255};
+        }
+    }
+    renderer->capacity = count;
+}
+
+/**
+ * Draws the tiles of a chunk in its render target with a single draw call
+ * \param game The game the chunk is in
+ * \param crow The row of the chunk in the game grid
+ * \param ccol The column of the chunk in the game grid
+ * \param target The render target of the chunk
+ */
+static void draw_chunk(Game *game, int crow, int ccol, SDL_Texture *target) {
+    TileRenderer *renderer = game->renderer;
+    SSGE_Tilemap *atlas = renderer->atlas;
+    float tile_w = atlas->tileWidth / renderer->atlas_w;
+    float tile_h = atlas->tileHeight / renderer->atlas_h;
+
+    int count = 0;
+    for (int row = 0; row < CHUNK_HEIGHT; row++) {
+        for (int col = 0; col < CHUNK_WIDTH; col++) {
+            const uint8_t *pos = atlas_tiles[tile_texture(game, crow * CHUNK_HEIGHT + row, ccol * CHUNK_WIDTH + col)];
+            float u = pos[1] * (atlas->tileWidth + atlas->spacing) / renderer->atlas_w;
+            float v = pos[0] * (atlas->tileHeight + atlas->spacing) / renderer->atlas_h;
+            float x = (float)(col * SQUARE_SIZE);
+            float y = (float)(row * SQUARE_SIZE);
+            SDL_Vertex *quad = &renderer->vertices[count * 4];
+            quad[0].position = (SDL_FPoint){x, y};
+            quad[0].tex_coord = (SDL_FPoint){u, v};
+            quad[1].position = (SDL_FPoint){x + SQUARE_SIZE, y};
+            quad[1].tex_coord = (SDL_FPoint){u + tile_w, v};
+            quad[2].position = (SDL_FPoint){x + SQUARE_SIZE, y + SQUARE_SIZE};
+            quad[2].tex_coord = (SDL_FPoint){u + tile_w, v + tile_h};
+            quad[3].position = (SDL_FPoint){x, y + SQUARE_SIZE};
+            quad[3].tex_coord = (SDL_FPoint){u, v + tile_h};
+            count++;
+        }
+    }
+    SDL_SetRenderTarget(_engine->renderer, target);
+    SDL_RenderGeometry(_engine->renderer, atlas->texture, renderer->vertices, count * 4, renderer->indices, count * 6);
+}
+
+/**
+ * Draws the tiles of the grid, one render target per chunk
+ * \param game The game to draw the tiles of
+ * \note Only the chunks overlapping the window are drawn. They are drawn again in their target if
+ * they changed since they were last drawn, the hidden chunks stay dirty until they are visible
+ */
+void draw_tiles(Game *game) {
+    TileRenderer *renderer = game->renderer;
+    reserve_tiles(renderer, CHUNK_HEIGHT * CHUNK_WIDTH);
+    alloc_chunk_targets(game);
+
+    // Visible chunks of the grid
+    int crow0 = game->vy > 0 ? game->vy / CHUNK_PX_HEIGHT : 0;
+    int ccol0 = game->vx > 0 ? game->vx / CHUNK_PX_WIDTH : 0;
+    int crow1 = (game->vy + game->win_h - 1) / CHUNK_PX_HEIGHT;
+    int ccol1 = (game->vx + game->win_w - 1) / CHUNK_PX_WIDTH;
+    if (crow1 >= game->size) crow1 = game->size - 1;
+    if (ccol1 >= game->size) ccol1 = game->size - 1;
+
+    bool drawn = false;
+    for (int crow = crow0; crow <= crow1; crow++) {
+        for (int ccol = ccol0; ccol <= ccol1; ccol++) {
+            Chunk *chunk = get_chunk(game, crow, ccol);
+            if (chunk->dirty) {
+                draw_chunk(game, crow, ccol, renderer->targets[chunk - game->chunk_buffers]);
+                chunk->dirty = false;
+                drawn = true;
+            }
+        }
+    }
+    if (drawn) {
+        SDL_SetRenderTarget(_engine->renderer, NULL);
+    }
+    for (int crow = crow0; crow <= crow1; crow++) {
+        for (int ccol = ccol0; ccol <= ccol1; ccol++) {
+            SDL_Rect rect = {ccol * CHUNK_PX_WIDTH - game->vx, crow * CHUNK_PX_HEIGHT - game->vy, CHUNK_PX_WIDTH, CHUNK_PX_HEIGHT};
+            SDL_RenderCopy(_engine->renderer, renderer->targets[get_chunk(game, crow, ccol) - game->chunk_buffers], NULL, &rect);
+        }
+    }
+}
@@ -0,0 +1,165 @@
+#define SSGE_GET_SDL
+#include "game.h"
+#include "SSGE/SSGE_local.h"
+
+#define FIRST_GLYPH ' '
+#define LAST_GLYPH '~'
+#define GLYPH_COUNT (LAST_GLYPH - FIRST_GLYPH + 1)
+#define TEXT_ATLAS_WIDTH 512
+
+/**
+ * Glyph of the text atlas
+ */
+typedef struct _Glyph {
+    SDL_Rect rect; // Position of the glyph in the atlas, as rendered by SDL_ttf
+    int advance; // Horizontal offset to the next glyph
+} Glyph;
+
+struct _TextRenderer {
+    SDL_Texture *atlas; // White glyphs, the color is applied through the vertices
+    float atlas_w, atlas_h;
+    int height; // Height of a line of text
+    Glyph glyphs[GLYPH_COUNT];
+    SDL_Vertex *vertices; // 4 vertices per glyph
+    int *indices; // 6 indices per glyph, two triangles
+    int capacity; // Number of glyphs the buffers can hold
+};
+
+/**
+ * Creates the text renderer, rasterizes the printable ASCII glyphs of a font in an atlas
+ * \param game The game to create the renderer for
+ * \param filename The path to the font file
+ * \param size The size of the font
+ */
+void init_text_renderer(Game *game, char *filename, int size) {
+    TextRenderer *renderer = (TextRenderer *)calloc(1, sizeof(TextRenderer));
+    TTF_Font *font = TTF_OpenFont(filename, size);
+    if (renderer == NULL || font == NULL) {
+        fprintf(stderr, "Error loading the font %s: %s\n", filename, TTF_GetError());
+        exit(1);
+    }
+    renderer->height = TTF_FontHeight(font);
+
+    // Lays out the glyphs in rows, then copies them in the atlas
+    SDL_Surface *surfaces[GLYPH_COUNT];
+    int x = 0, y = 0;
+    for (int i = 0; i < GLYPH_COUNT; i++) {
+        Glyph *glyph = &renderer->glyphs[i];
+        surfaces[i] = TTF_RenderGlyph_Blended(font, FIRST_GLYPH + i, (SDL_Color){255, 255, 255, 255});
+        if (surfaces[i] == NULL || TTF_GlyphMetrics(font, FIRST_GLYPH + i, NULL, NULL, NULL, NULL, &glyph->advance) != 0) {
+            fprintf(stderr, "Error rendering the font %s: %s\n", filename, TTF_GetError());
+            exit(1);
+        }
+        if (x + surfaces[i]->w > TEXT_ATLAS_WIDTH) {
+            x = 0;
+            y += renderer->height;
+        }
+        glyph->rect = (SDL_Rect){x, y, surfaces[i]->w, surfaces[i]->h};
+        x += surfaces[i]->w;
+    }
+    SDL_Surface *atlas = SDL_CreateRGBSurfaceWithFormat(0, TEXT_ATLAS_WIDTH, y + renderer->height, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (atlas == NULL) {
+        fprintf(stderr, "Error creating the text atlas: %s\n", SDL_GetError());
+        exit(1);
+    }
+    for (int i = 0; i < GLYPH_COUNT; i++) {
+        // Copies the alpha of the glyphs instead of blending them on the empty atlas
+        SDL_SetSurfaceBlendMode(surfaces[i], SDL_BLENDMODE_NONE);
+        SDL_BlitSurface(surfaces[i], NULL, atlas, &renderer->glyphs[i].rect);
+        SDL_FreeSurface(surfaces[i]);
+    }
+    TTF_CloseFont(font);
+
+    renderer->atlas = SDL_CreateTextureFromSurface(_engine->renderer, atlas);
+    renderer->atlas_w = (float)atlas->w;
+    renderer->atlas_h = (float)atlas->h;
+    SDL_FreeSurface(atlas);
+    if (renderer->atlas == NULL) {
+        fprintf(stderr, "Error creating the text atlas: %s\n", SDL_GetError());
+        exit(1);
+    }
+    SDL_SetTextureBlendMode(renderer->atlas, SDL_BLENDMODE_BLEND);
+    game->text = renderer;
+}
+
+/**
+ * Destroys the text renderer
+ * \param game The game to destroy the renderer of
+ */
+void free_text_renderer(Game *game) {
+    TextRenderer *renderer = game->text;
+    if (renderer == NULL) {
+        return;
+    }
+    SDL_DestroyTexture(renderer->atlas);
+    free(renderer->vertices);
+    free(renderer->indices);
+    free(renderer);
+    game->text = NULL;
+}
+
+/**
+ * Grows the vertex and index buffers of the text renderer
+ * \param renderer The renderer to grow the buffers of
+ * \param count The number of glyphs the buffers must hold
+ */
+static void reserve_glyphs(TextRenderer *renderer, int count) {
+    if (count <= renderer->capacity) {
+        return;
+    }
+    renderer->vertices = (SDL_Vertex *)realloc(renderer->vertices, count * 4 * sizeof(SDL_Vertex));
+    renderer->indices = (int *)realloc(renderer->indices, count * 6 * sizeof(int));
+    if (renderer->vertices == NULL || renderer->indices == NULL) {
+        fprintf(stderr, "Error allocating the text renderer buffers\n");
+        exit(1);
+    }
+    for (int i = 0; i < count; i++) {
+        int *quad = &renderer->indices[i * 6];
+        quad[0] = i*4; quad[1] = i*4 + 1; quad[2] = i*4 + 2;
+        quad[3] = i*4 + 2; quad[4] = i*4 + 3; quad[5] = i*4;
+    }
+    renderer->capacity = count;
+}
+
+/**
+ * Draws a line of text with a single draw call
+ * \param game The game to draw the text for
+ * \param text The text to draw, the characters out of the printable ASCII range are drawn as spaces
+ * \param x The x position of the anchor
+ * \param y The y position of the anchor
+ * \param color The color of the text, alpha included
+ * \param anchor The point of the text placed at (x, y)
+ */
+void draw_text(Game *game, char *text, int x, int y, SSGE_Color color, SSGE_Anchor anchor) {
+    TextRenderer *renderer = game->text;
+    int length = (int)strlen(text);
+    if (length == 0) {
+        return;
+    }
+    reserve_glyphs(renderer, length);
+
+    int width = 0;
+    for (int i = 0; i < length; i++) {
+        int c = (unsigned char)text[i];
+        width += renderer->glyphs[c >= FIRST_GLYPH && c <= LAST_GLYPH ? c - FIRST_GLYPH : 0].advance;
+    }
+    x -= anchor % 3 * width / 2;
+    y -= anchor / 3 * renderer->height / 2;
+
+    SDL_Color vertex_color = {color.r, color.g, color.b, color.a};
+    for (int i = 0; i < length; i++) {
+        int c = (unsigned char)text[i];
+        Glyph *glyph = &renderer->glyphs[c >= FIRST_GLYPH && c <= LAST_GLYPH ? c - FIRST_GLYPH : 0];
+        float u0 = glyph->rect.x / renderer->atlas_w, u1 = (glyph->rect.x + glyph->rect.w) / renderer->atlas_w;
+        float v0 = glyph->rect.y / renderer->atlas_h, v1 = (glyph->rect.y + glyph->rect.h) / renderer->atlas_h;
+        float x0 = (float)x, x1 = (float)(x + glyph->rect.w);
+        float y0 = (float)y, y1 = (float)(y + glyph->rect.h);
+        SDL_Vertex *quad = &renderer->vertices[i * 4];
+        quad[0] = (SDL_Vertex){{x0, y0}, vertex_color, {u0, v0}};
+        quad[1] = (SDL_Vertex){{x1, y0}, vertex_color, {u1, v0}};
+        quad[2] = (SDL_Vertex){{x1, y1}, vertex_color, {u1, v1}};
+        quad[3] = (SDL_Vertex){{x0, y1}, vertex_color, {u0, v1}};
+        x += glyph->advance;
+    }
+    SDL_RenderGeometry(_engine->renderer, renderer->atlas, renderer->vertices, length * 4, renderer->indices, length * 6);
+}
@@ -0,0 +1,377 @@
+#include "game.h"
+
+#include <SDL2/SDL_thread.h>
+#include <SDL2/SDL_mutex.h>
+
+enum _ready_state {
+    R_FREE = 0,
+    R_QUEUED,
+    R_WORKING,
+    R_READY
+};
+
+/**
+ * Entry of the ready cache, a chunk prepared by a worker
+ */
+typedef struct _ReadyChunk {
+    int state;
+    uint32_t ticket; // Identifies the job, a worker result is dropped if the entry was reused meanwhile
+    int crow, ccol; // Chunk coordinates
+    uint64_t seed; // World seed the chunk is generated from
+    bool stored; // The chunk was loaded from its save file
+    uint8_t tiles[CHUNK_HEIGHT][CHUNK_WIDTH];
+} ReadyChunk;
+
+/**
+ * Chunk waiting to be written to its save file by a worker
+ */
+typedef struct _ChunkWrite {
+    bool busy; // A worker is writing the chunk
+    int crow, ccol; // Chunk coordinates
+    uint8_t tiles[CHUNK_HEIGHT][CHUNK_WIDTH];
+} ChunkWrite;
+
+struct _WorkerPool {
+    SDL_Thread **threads;
+    int count; // Number of worker threads
+    SDL_mutex *mutex; // Protects everything below
+    SDL_cond *cond; // Signaled when a job is queued or the pool stops
+    SDL_cond *written; // Signaled when a chunk write is done
+    bool quit;
+    uint32_t next_ticket;
+    ReadyChunk *entries;
+    int capacity;
+    ChunkWrite *writes; // Queued writes, newer than the save files of their chunks
+    int write_count;
+    int write_capacity;
+};
+
+/**
+ * Finds the latest queued write of a chunk
+ * \param pool The pool to search the writes of, must be locked
+ * \param crow The row of the chunk
+ * \param ccol The column of the chunk
+ * \return The write, NULL if the save file of the chunk is up to date
+ */
+static ChunkWrite *find_write(WorkerPool *pool, int crow, int ccol) {
+    ChunkWrite *found = NULL;
+    for (int i = 0; i < pool->write_count; i++) {
+        ChunkWrite *write = &pool->writes[i];
+        // A write that is not started is always newer than the one in progress
+        if (write->crow == crow && write->ccol == ccol && (found == NULL || !write->busy)) {
+            found = write;
+        }
+    }
+    return found;
+}
+
+/**
+ * Finds a write no worker is busy with, that no other worker writes the file of
+ * \param pool The pool to search the writes of, must be locked
+ */
+static ChunkWrite *next_write(WorkerPool *pool) {
+    for (int i = 0; i < pool->write_count; i++) {
+        ChunkWrite *write = &pool->writes[i];
+        if (!write->busy && find_write(pool, write->crow, write->ccol) == write) {
+            bool file_busy = false;
+            for (int j = 0; j < pool->write_count && !file_busy; j++) {
+                file_busy = pool->writes[j].busy && pool->writes[j].crow == write->crow && pool->writes[j].ccol == write->ccol;
+            }
+            if (!file_busy) {
+                return write;
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Main loop of a worker thread, prepares the queued chunks until the pool stops
+ * \param data The pool of the worker
+ */
+static int worker_main(void *data) {
+    WorkerPool *pool = (WorkerPool *)data;
+    SDL_LockMutex(pool->mutex);
+    while (!pool->quit) {
+        // Reads go first as the update thread waits for them, the chunks with a queued write are
+        // copied from it
+        ReadyChunk *entry = NULL;
+        for (int i = 0; i < pool->capacity; i++) {
+            if (pool->entries[i].state == R_QUEUED) {
+                entry = &pool->entries[i];
+                break;
+            }
+        }
+        if (entry != NULL) {
+            entry->state = R_WORKING;
+            ReadyChunk job = *entry;
+            ChunkWrite *queued = find_write(pool, job.crow, job.ccol);
+            if (queued != NULL) {
+                memcpy(job.tiles, queued->tiles, sizeof(job.tiles));
+            }
+            SDL_UnlockMutex(pool->mutex);
+
+            // The file is read or the chunk generated outside of the lock
+            job.stored = queued != NULL || load_chunk(job.tiles, job.crow, job.ccol);
+            if (!job.stored) {
+                gen_chunk(job.tiles, job.seed, job.crow, job.ccol, NULL);
+            }
+
+            SDL_LockMutex(pool->mutex);
+            for (int i = 0; i < pool->capacity; i++) {
+                if (pool->entries[i].state == R_WORKING && pool->entries[i].ticket == job.ticket) {
+                    job.state = R_READY;
+                    pool->entries[i] = job;
+                    break;
+                }
+            }
+            continue;
+        }
+
+        ChunkWrite *write = next_write(pool);
+        if (write != NULL) {
+            write->busy = true;
+            int crow = write->crow, ccol = write->ccol;
+            uint8_t tiles[CHUNK_HEIGHT][CHUNK_WIDTH];
+            memcpy(tiles, write->tiles, sizeof(tiles));
+            SDL_UnlockMutex(pool->mutex);
+
+            save_chunk(tiles, crow, ccol);
+
+            SDL_LockMutex(pool->mutex);
+            for (int i = 0; i < pool->write_count; i++) {
+                if (pool->writes[i].busy && pool->writes[i].crow == crow && pool->writes[i].ccol == ccol) {
+                    pool->writes[i] = pool->writes[--pool->write_count];
+                    break;
+                }
+            }
+            SDL_CondBroadcast(pool->written);
+            continue;
+        }
+        SDL_CondWait(pool->cond, pool->mutex);
+    }
+    SDL_UnlockMutex(pool->mutex);
+    return 0;
+}
+
+/**
+ * Starts the chunk workers
+ * \param game The game to start the workers for
+ * \param count The number of worker threads, 0 prepares the chunks on the update thread
+ */
+void start_workers(Game *game, int count) {
+    game->workers = NULL;
+    if (count <= 0) {
+        return;
+    }
+    WorkerPool *pool = (WorkerPool *)calloc(1, sizeof(WorkerPool));
+    if (pool == NULL) {
+        fprintf(stderr, "Error allocating the chunk workers\n");
+        exit(1);
+    }
+    pool->threads = (SDL_Thread **)calloc(count, sizeof(SDL_Thread *));
+    pool->mutex = SDL_CreateMutex();
+    pool->cond = SDL_CreateCond();
+    pool->written = SDL_CreateCond();
+    if (pool->threads == NULL || pool->mutex == NULL || pool->cond == NULL || pool->written == NULL) {
+        fprintf(stderr, "Error creating the chunk workers\n");
+        exit(1);
+    }
+    for (int i = 0; i < count; i++) {
+        pool->threads[i] = SDL_CreateThread(worker_main, "chunk worker", pool);
+        if (pool->threads[i] == NULL) {
+            fprintf(stderr, "Error creating the chunk workers: %s\n", SDL_GetError());
+            exit(1);
+        }
+    }
+    pool->count = count;
+    game->workers = pool;
+}
+
+/**
+ * Stops the chunk workers, waits for the jobs in progress and the queued writes
+ * \param game The game to stop the workers of
+ */
+void stop_workers(Game *game) {
+    WorkerPool *pool = game->workers;
+    if (pool == NULL) {
+        return;
+    }
+    flush_chunk_writes(game);
+    SDL_LockMutex(pool->mutex);
+    pool->quit = true;
+    SDL_CondBroadcast(pool->cond);
+    SDL_UnlockMutex(pool->mutex);
+    for (int i = 0; i < pool->count; i++) {
+        SDL_WaitThread(pool->threads[i], NULL);
+    }
+    SDL_DestroyCond(pool->cond);
+    SDL_DestroyCond(pool->written);
+    SDL_DestroyMutex(pool->mutex);
+    free(pool->threads);
+    free(pool->entries);
+    free(pool->writes);
+    free(pool);
+    game->workers = NULL;
+}
+
+/**
+ * Queues the ring of chunks around the grid and drops the other chunks of the ready cache
+ * \param game The game to prefetch the chunks for
+ * \note Must be called when the grid, its center or the seed changes
+ */
+void prefetch_chunks(Game *game) {
+    WorkerPool *pool = game->workers;
+    if (pool == NULL) {
+        return;
+    }
+    int radius = game->radius + 1;
+    int ring = 8 * radius; // (2*radius + 1)^2 - (2*radius - 1)^2
+    SDL_LockMutex(pool->mutex);
+    if (pool->capacity < ring) {
+        // Results of the jobs in progress are dropped as the entries are cleared
+        free(pool->entries);
+        pool->entries = (ReadyChunk *)calloc(ring, sizeof(ReadyChunk));
+        if (pool->entries == NULL) {
+            fprintf(stderr, "Error allocating the ready cache\n");
+            exit(1);
+        }
+        pool->capacity = ring;
+    }
+
+    // Drops the entries out of the ring or from another seed
+    for (int i = 0; i < pool->capacity; i++) {
+        ReadyChunk *entry = &pool->entries[i];
+        if (entry->state == R_FREE) {
+            continue;
+        }
+        int drow = entry->crow - game->cy;
+        int dcol = entry->ccol - game->cx;
+        bool in_ring = abs(drow) <= radius && abs(dcol) <= radius && (abs(drow) == radius || abs(dcol) == radius);
+        if (!in_ring || entry->seed != game->seed || chunk_cached(game, entry->crow, entry->ccol)) {
+            entry->state = R_FREE;
+        }
+    }
+
+    // Queues the missing ones
+    for (int drow = -radius; drow <= radius; drow++) {
+        for (int dcol = -radius; dcol <= radius; dcol++) {
+            if (abs(drow) != radius && abs(dcol) != radius) {
+                continue;
+            }
+            int crow = game->cy + drow, ccol = game->cx + dcol;
+            int free_entry = -1;
+            bool found = false;
+            for (int i = 0; i < pool->capacity && !found; i++) {
+                ReadyChunk *entry = &pool->entries[i];
+                found = entry->state != R_FREE && entry->crow == crow && entry->ccol == ccol;
+                if (entry->state == R_FREE && free_entry == -1) {
+                    free_entry = i;
+                }
+            }
+            // The cached chunks are copied from the chunk cache instead
+            if (!found && free_entry != -1 && !chunk_cached(game, crow, ccol)) {
+                ReadyChunk *entry = &pool->entries[free_entry];
+                entry->state = R_QUEUED;
+                entry->ticket = pool->next_ticket++;
+                entry->crow = crow;
+                entry->ccol = ccol;
+                entry->seed = game->seed;
+            }
+        }
+    }
+    SDL_CondBroadcast(pool->cond);
+    SDL_UnlockMutex(pool->mutex);
+}
+
+/**
+ * Takes a chunk from the ready cache
+ * \param game The game to take the chunk from
+ * \param crow The row of the chunk
+ * \param ccol The column of the chunk
+ * \param tiles The tiles to copy the chunk in
+ * \param stored The variable to store if the chunk was loaded from its save file in
+ * \return True if the chunk was ready, false if it must be prepared by the caller
+ * \note Never waits for a worker, a chunk still in progress is dropped. A chunk with a queued
+ * write is copied from it, as its save file is not up to date
+ */
+bool take_ready_chunk(Game *game, int crow, int ccol, uint8_t tiles[CHUNK_HEIGHT][CHUNK_WIDTH], bool *stored) {
+    WorkerPool *pool = game->workers;
+    if (pool == NULL) {
+        return false;
+    }
+    bool ready = false;
+    SDL_LockMutex(pool->mutex);
+    ChunkWrite *queued = find_write(pool, crow, ccol);
+    if (queued != NULL) {
+        memcpy(tiles, queued->tiles, sizeof(queued->tiles));
+        *stored = true;
+        ready = true;
+    }
+    for (int i = 0; i < pool->capacity; i++) {
+        ReadyChunk *entry = &pool->entries[i];
+        if (entry->state != R_FREE && entry->crow == crow && entry->ccol == ccol && entry->seed == game->seed) {
+            if (entry->state == R_READY && queued == NULL) {
+                ready = true;
+                memcpy(tiles, entry->tiles, sizeof(entry->tiles));
+                *stored = entry->stored;
+            }
+            entry->state = R_FREE;
+            break;
+        }
+    }
+    SDL_UnlockMutex(pool->mutex);
+    return ready;
+}
+
+/**
+ * Saves a chunk in its file from a worker, or right away if there are no workers
+ * \param game The game the chunk is saved from
+ * \param tiles The tiles of the chunk, copied in the queue
+ * \param crow The row of the chunk
+ * \param ccol The column of the chunk
+ * \note A write of the chunk that is not started yet is replaced
+ */
+void queue_chunk_save(Game *game, uint8_t tiles[CHUNK_HEIGHT][CHUNK_WIDTH], int crow, int ccol) {
+    WorkerPool *pool = game->workers;
+    game->write_volume += CHUNK_HEIGHT * CHUNK_WIDTH;
+    if (pool == NULL) {
+        save_chunk(tiles, crow, ccol);
+        return;
+    }
+    SDL_LockMutex(pool->mutex);
+    ChunkWrite *write = find_write(pool, crow, ccol);
+    if (write == NULL || write->busy) {
+        if (pool->write_count == pool->write_capacity) {
+            pool->write_capacity = pool->write_capacity ? pool->write_capacity * 2 : 16;
+            pool->writes = (ChunkWrite *)realloc(pool->writes, pool->write_capacity * sizeof(ChunkWrite));
+            if (pool->writes == NULL) {
+                fprintf(stderr, "Error allocating the chunk writes\n");
+                exit(1);
+            }
+        }
+        write = &pool->writes[pool->write_count++];
+        write->busy = false;
+        write->crow = crow;
+        write->ccol = ccol;
+    }
+    memcpy(write->tiles, tiles, sizeof(write->tiles));
+    SDL_CondBroadcast(pool->cond);
+    SDL_UnlockMutex(pool->mutex);
+}
+
+/**
+ * Waits for the queued chunk writes, so the save files are up to date
+ * \param game The game to wait for the writes of
+ */
+void flush_chunk_writes(Game *game) {
+    WorkerPool *pool = game->workers;
+    if (pool == NULL) {
+        return;
+    }
+    SDL_LockMutex(pool->mutex);
+    while (pool->write_count > 0) {
+        SDL_CondWait(pool->written, pool->mutex);
+    }
+    SDL_UnlockMutex(pool->mutex);
+}
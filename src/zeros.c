@@ -0,0 +1,242 @@
+#include "game.h"
+
+/**
+ * Finds the root of a component in a union-find forest, with path halving
+ * \param parent The forest
+ * \param id The component
+ */
+static int find_root(int *parent, int id) {
+    while (parent[id] != id) {
+        parent[id] = parent[parent[id]];
+        id = parent[id];
+    }
+    return id;
+}
+
+/**
+ * Merges two components of a union-find forest
+ * \param parent The forest
+ * \param a The first component
+ * \param b The second component
+ */
+static void union_roots(int *parent, int a, int b) {
+    a = find_root(parent, a);
+    b = find_root(parent, b);
+    if (a != b) {
+        parent[a < b ? b : a] = a < b ? a : b;
+    }
+}
+
+/**
+ * Checks if a tile of a chunk can be part of a 0 area (a 0 that is not flagged)
+ */
+static bool is_zero_tile(Chunk *chunk, int row, int col) {
+    return get_tile_value(chunk->tiles[row][col]) == 0 && !((chunk->planes.bits[P_FLAGGED][row] >> col) & 1);
+}
+
+/**
+ * Labels the 8-connected areas of 0 of a chunk
+ * \param chunk The chunk to label, its tiles and bitplanes must be up to date
+ * \note Flagged tiles are not part of the areas, revealed ones are
+ */
+void build_zero_labels(Chunk *chunk) {
+    int parent[CHUNK_HEIGHT * CHUNK_WIDTH];
+    for (int row = 0; row < CHUNK_HEIGHT; row++) {
+        for (int col = 0; col < CHUNK_WIDTH; col++) {
+            int id = row * CHUNK_WIDTH + col;
+            parent[id] = id;
+            if (!is_zero_tile(chunk, row, col)) {
+                continue;
+            }
+            // Merges with the already scanned neighbours: left, up-left, up and up-right
+            if (col > 0 && is_zero_tile(chunk, row, col - 1)) union_roots(parent, id, id - 1);
+            if (row > 0) {
+                for (int j = col - 1; j <= col + 1; j++) {
+                    if (j >= 0 && j < CHUNK_WIDTH && is_zero_tile(chunk, row - 1, j)) {
+                        union_roots(parent, id, id - CHUNK_WIDTH + j - col);
+                    }
+                }
+            }
+        }
+    }
+
+    // Numbers the areas from 1 and gathers their tiles
+    memset(chunk->zero_labels, 0, sizeof(chunk->zero_labels));
+    memset(chunk->zero_rows, 0, sizeof(chunk->zero_rows));
+    chunk->zero_count = 0;
+    for (int row = 0; row < CHUNK_HEIGHT; row++) {
+        for (int col = 0; col < CHUNK_WIDTH; col++) {
+            if (!is_zero_tile(chunk, row, col)) {
+                continue;
+            }
+            int root = find_root(parent, row * CHUNK_WIDTH + col);
+            uint8_t *root_label = &chunk->zero_labels[root / CHUNK_WIDTH][root % CHUNK_WIDTH];
+            if (*root_label == 0) {
+                *root_label = ++chunk->zero_count;
+            }
+            chunk->zero_labels[row][col] = *root_label;
+            chunk->zero_rows[*root_label - 1][row] |= 1ULL << col;
+        }
+    }
+    chunk->zero_stale = false;
+}
+
+/**
+ * Gets the component of the 0 area of a tile of the grid
+ * \param game The game to get the component from
+ * \param row The row of the tile
+ * \param col The column of the tile
+ * \return The index of the component in `game->zero_parent`, -1 if the tile is not part of an area
+ */
+static int zero_component(Game *game, int row, int col) {
+    Chunk *chunk = get_chunk(game, row / CHUNK_HEIGHT, col / CHUNK_WIDTH);
+    uint8_t label = chunk->zero_labels[row % CHUNK_HEIGHT][col % CHUNK_WIDTH];
+    if (label == 0) {
+        return -1;
+    }
+    return (int)(chunk - game->chunk_buffers) * MAX_ZERO_COMPONENTS + label - 1;
+}
+
+/**
+ * Merges the component of a tile with the ones of up to 3 tiles of the other side of a seam
+ * \param game The game to merge the components in
+ * \param row The row of the tile
+ * \param col The column of the tile
+ * \param drow The row step to the other side, 0 for a vertical seam
+ * \param dcol The column step to the other side, 0 for an horizontal seam
+ */
+static void stitch_tile(Game *game, int row, int col, int drow, int dcol) {
+    int id = zero_component(game, row, col);
+    if (id < 0) {
+        return;
+    }
+    for (int k = -1; k <= 1; k++) {
+        int i = row + drow + (drow == 0 ? k : 0);
+        int j = col + dcol + (dcol == 0 ? k : 0);
+        if (in_grid(game, i, j)) {
+            int other = zero_component(game, i, j);
+            if (other >= 0) {
+                union_roots(game->zero_parent, id, other);
+            }
+        }
+    }
+}
+
+/**
+ * Brings the 0 areas up to date, labels the stale chunks and stitches the areas across the seams
+ * \param game The game to update the areas of
+ */
+void update_zero_components(Game *game) {
+    if (!game->zero_stale) {
+        return;
+    }
+    int size = game->size;
+    for (int i = 0; i < size * size; i++) {
+        if (game->chunks[i]->zero_stale) {
+            build_zero_labels(game->chunks[i]);
+        }
+    }
+    for (int i = 0; i < size * size * MAX_ZERO_COMPONENTS; i++) {
+        game->zero_parent[i] = i;
+    }
+    for (int k = 1; k < size; k++) {
+        for (int row = 0; row < game->map_h; row++) {
+            stitch_tile(game, row, k * CHUNK_WIDTH - 1, 0, 1);
+        }
+        for (int col = 0; col < game->map_w; col++) {
+            stitch_tile(game, k * CHUNK_HEIGHT - 1, col, 1, 0);
+        }
+    }
+    game->zero_stale = false;
+}
+
+/**
+ * Marks the 0 areas of the chunks overlapping an area of the grid as stale
+ * \param game The game to mark the chunks of
+ * \param row0 The first row of the area
+ * \param col0 The first column of the area
+ * \param row1 The row after the last row of the area
+ * \param col1 The column after the last column of the area
+ */
+void invalidate_zero_components(Game *game, int row0, int col0, int row1, int col1) {
+    for (int crow = row0 / CHUNK_HEIGHT; crow <= (row1 - 1) / CHUNK_HEIGHT; crow++) {
+        for (int ccol = col0 / CHUNK_WIDTH; ccol <= (col1 - 1) / CHUNK_WIDTH; ccol++) {
+            get_chunk(game, crow, ccol)->zero_stale = true;
+        }
+    }
+    game->zero_stale = true;
+}
+
+/**
+ * Gets a chunk row of the selected area padded with one halo bit on each side
+ * \note Same layout as `padded_plane_row`
+ */
+static uint64_t padded_area_row(Game *game, int row, int ccol) {
+    if (row < 0 || row >= game->map_h) {
+        return 0;
+    }
+    uint64_t *area = &game->zero_area[(row / CHUNK_HEIGHT * game->size + ccol) * CHUNK_HEIGHT + row % CHUNK_HEIGHT];
+    uint64_t word = area[0] << 1;
+    if (ccol > 0) {
+        word |= (area[-CHUNK_HEIGHT] >> (CHUNK_WIDTH - 1)) & 1;
+    }
+    if (ccol < game->size - 1) {
+        word |= (area[CHUNK_HEIGHT] & 1) << (CHUNK_WIDTH + 1);
+    }
+    return word;
+}
+
+/**
+ * Reveals the 0 area of a tile and the numbers around it in bulk
+ * \param game The game to reveal the area in
+ * \param row The row of the tile, which must be a 0 and not flagged
+ * \param col The column of the tile
+ * \return The number of revealed tiles
+ * \note The tiles out of the grid around the area are queued as pending reveals
+ */
+int reveal_zero_area(Game *game, int row, int col) {
+    update_zero_components(game);
+    int size = game->size;
+    int root = find_root(game->zero_parent, zero_component(game, row, col));
+
+    // Selects the chunk areas of the component
+    memset(game->zero_area, 0, size * size * CHUNK_HEIGHT * sizeof(uint64_t));
+    for (int i = 0; i < size * size; i++) {
+        Chunk *chunk = game->chunks[i];
+        int base = (int)(chunk - game->chunk_buffers) * MAX_ZERO_COMPONENTS;
+        for (int label = 0; label < chunk->zero_count; label++) {
+            if (find_root(game->zero_parent, base + label) == root) {
+                for (int r = 0; r < CHUNK_HEIGHT; r++) {
+                    game->zero_area[i * CHUNK_HEIGHT + r] |= chunk->zero_rows[label][r];
+                }
+            }
+        }
+    }
+
+    // Reveals the area grown by one tile, which adds the numbers around it
+    int count = 0;
+    uint64_t row_mask = (1ULL << CHUNK_WIDTH) - 1;
+    for (int crow = 0; crow < size; crow++) {
+        for (int ccol = 0; ccol < size; ccol++) {
+            Chunk *chunk = get_chunk(game, crow, ccol);
+            ChunkPlanes *planes = &chunk->planes;
+            for (int r = 0; r < CHUNK_HEIGHT; r++) {
+                int grid_row = crow * CHUNK_HEIGHT + r;
+                uint64_t word = padded_area_row(game, grid_row - 1, ccol) | padded_area_row(game, grid_row, ccol) | padded_area_row(game, grid_row + 1, ccol);
+                uint64_t reveal = (word | word >> 1 | word >> 2) & row_mask & ~planes->bits[P_REVEALED][r] & ~planes->bits[P_FLAGGED][r];
+                planes->bits[P_REVEALED][r] |= reveal;
+                if (reveal) {
+                    chunk->dirty = chunk->unsaved = true;
+                }
+                count += __builtin_popcountll(reveal);
+                while (reveal) {
+                    int j = __builtin_ctzll(reveal);
+                    reveal &= reveal - 1;
+                    store_tile_state(&chunk->tiles[r][j], REVEALED);
+                }
+            }
+        }
+    }
+    queue_area_edges(game);
+    return count;
+}
@@ -0,0 +1,514 @@
+#define SDL_MAIN_HANDLED // The benchmark has its own entry point, it is linked without SDL2main
+#define SSGE_GET_SDL
+#include "game.h"
+#include "SSGE/SSGE_local.h"
+
+#include <SDL2/SDL_hints.h>
+#include <SDL2/SDL_timer.h>
+
+/**
+ * Gets the seconds elapsed since a performance counter value
+ * \param start The value of the performance counter at the start
+ */
+static double elapsed(Uint64 start) {
+    return (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+}
+
+/**
+ * Fills the grid with random mines and states, the other tiles are 0
+ * \param game The game to fill the grid of
+ * \param density The percentage of mines
+ * \param state The state of the generator
+ */
+static void fill_random_grid(Game *game, int density, uint64_t *state) {
+    for (int row = 0; row < game->map_h; row++) {
+        for (int col = 0; col < game->map_w; col++) {
+            uint8_t *tile = get_tile(game, row, col);
+            *tile = (int)random_below(state, 100) < density ? 9 : 0;
+            store_tile_state(tile, (uint8_t)random_below(state, 3));
+        }
+    }
+    build_planes(game);
+}
+
+/**
+ * Compares the byte grid and the bitplanes on the neighbourhood scans of the game: counting the
+ * revealed tiles around every tile, and checking if a tile has a revealed neighbour
+ */
+static void bench_bitplanes() {
+    Game *game = (Game *)malloc(sizeof(Game));
+    init_window(game, 1920, 1080);
+    uint64_t state = 1;
+    fill_random_grid(game, 20, &state);
+    int cells = game->map_h * game->map_w, runs = 500;
+    volatile int sink = 0;
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int k = 0; k < runs; k++) {
+        int total = 0;
+        for (int row = 0; row < game->map_h; row++) {
+            for (int col = 0; col < game->map_w; col++) {
+                for (int i = row - 1; i <= row + 1; i++) {
+                    for (int j = col - 1; j <= col + 1; j++) {
+                        total += in_grid(game, i, j) && get_tile_state(*get_tile(game, i, j)) == REVEALED;
+                    }
+                }
+            }
+        }
+        sink += total;
+    }
+    double bytes = elapsed(start);
+    start = SDL_GetPerformanceCounter();
+    for (int k = 0; k < runs; k++) {
+        int total = 0;
+        for (int row = 0; row < game->map_h; row++) {
+            for (int col = 0; col < game->map_w; col++) {
+                total += __builtin_popcount(neighbourhood_bits(game, P_REVEALED, row, col));
+            }
+        }
+        sink += total;
+    }
+    double planes = elapsed(start);
+    printf("revealed neighbour count %dx%d: byte grid %6.1f Mcells/s, bitplanes %6.1f Mcells/s\n", game->map_h, game->map_w, (double)cells * runs / bytes / 1e6, (double)cells * runs / planes / 1e6);
+
+    start = SDL_GetPerformanceCounter();
+    for (int k = 0; k < runs; k++) {
+        int total = 0;
+        for (int row = 0; row < game->map_h; row++) {
+            for (int col = 0; col < game->map_w; col++) {
+                bool any = false;
+                for (int i = row - 1; i <= row + 1 && !any; i++) {
+                    for (int j = col - 1; j <= col + 1 && !any; j++) {
+                        any = (i != row || j != col) && in_grid(game, i, j) && get_tile_state(*get_tile(game, i, j)) == REVEALED;
+                    }
+                }
+                total += any;
+            }
+        }
+        sink += total;
+    }
+    bytes = elapsed(start);
+    start = SDL_GetPerformanceCounter();
+    for (int k = 0; k < runs; k++) {
+        int total = 0;
+        for (int row = 0; row < game->map_h; row++) {
+            for (int col = 0; col < game->map_w; col++) {
+                total += (neighbourhood_bits(game, P_REVEALED, row, col) & ~(1 << 4)) != 0;
+            }
+        }
+        sink += total;
+    }
+    planes = elapsed(start);
+    printf("any revealed neighbour %dx%d:   byte grid %6.1f Mcells/s, bitplanes %6.1f Mcells/s\n", game->map_h, game->map_w, (double)cells * runs / bytes / 1e6, (double)cells * runs / planes / 1e6);
+    free_chunks(game);
+    free(game);
+}
+
+/**
+ * Generates the numbers of the grid with the original 3x3 loop over the grid
+ * \param game The game to generate the numbers in
+ */
+static void reference_numbers(Game *game) {
+    for (int row = 0; row < game->map_h; row++) {
+        for (int col = 0; col < game->map_w; col++) {
+            uint8_t *tile = get_tile(game, row, col);
+            if (get_tile_value(*tile) == 9) {
+                continue;
+            }
+            uint8_t count = 0;
+            for (int i = row - 1; i <= row + 1; i++) {
+                for (int j = col - 1; j <= col + 1; j++) {
+                    if (in_grid(game, i, j) && get_tile_value(*get_tile(game, i, j)) == 9) {
+                        count++;
+                    }
+                }
+            }
+            store_tile_value(tile, count);
+        }
+    }
+}
+
+/**
+ * Measures the throughput of `gen_numbers` with each kernel, and of the 3x3 loop it replaced
+ */
+static void bench_numbers() {
+    const char *kernels[] = {"scalar", "sse2", "avx2"};
+    Game *game = (Game *)malloc(sizeof(Game));
+    init_window(game, 1920, 1080);
+    uint64_t state = 1;
+    fill_random_grid(game, 20, &state);
+    int cells = game->map_h * game->map_w, runs = 2000;
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < runs; i++) {
+        reference_numbers(game);
+    }
+    printf("gen_numbers %dx%d %-8s %8.1f Mcells/s\n", game->map_h, game->map_w, "3x3 loop", (double)cells * runs / elapsed(start) / 1e6);
+    for (int k = 0; k < 3; k++) {
+        if (!use_number_kernel(kernels[k])) {
+            continue;
+        }
+        start = SDL_GetPerformanceCounter();
+        for (int i = 0; i < runs; i++) {
+            gen_numbers(game);
+        }
+        printf("gen_numbers %dx%d %-8s %8.1f Mcells/s\n", game->map_h, game->map_w, kernels[k], (double)cells * runs / elapsed(start) / 1e6);
+    }
+    use_number_kernel(NULL);
+    free_chunks(game);
+    free(game);
+}
+
+/**
+ * Measures the worst case of a click: a mine-free grid opened from its center, at the radius of a
+ * small, a large and the largest window. The time includes the labelling of the 0 areas and the
+ * tiles queued out of the grid
+ */
+static void bench_reveal_area() {
+    const int radii[] = {1, 4, 7};
+    Game *game = (Game *)malloc(sizeof(Game));
+    for (int k = 0; k < 3; k++) {
+        init_window(game, 2*radii[k] * CHUNK_PX_WIDTH, 2*radii[k] * CHUNK_PX_HEIGHT);
+        game->cx = game->cy = 0;
+        game->score = 0;
+        int runs = 200, revealed = 0;
+        double seconds = 0;
+        for (int i = 0; i < runs; i++) {
+            init_chunks(game);
+            build_planes(game);
+            clear_pending_reveals(game);
+            uint32_t score = game->score;
+            Uint64 start = SDL_GetPerformanceCounter();
+            reveal_tile(game, game->map_h / 2, game->map_w / 2);
+            seconds += elapsed(start);
+            revealed = game->score - score;
+        }
+        printf("reveal_tile %3dx%-3d mine-free grid: %8.3f ms, %6d tiles revealed\n", game->map_h, game->map_w, seconds * 1e3 / runs, revealed);
+        free_chunks(game);
+        free(game->pending);
+    }
+    free(game);
+}
+
+/**
+ * Generates the mines in a chunk as the original `gen_mines` did, drawing again on a collision
+ * \param chunk The chunk to generate the mines in
+ * \param state The state of the random generator
+ */
+static void reference_mines(uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH], uint64_t *state) {
+    for (int i = 0; i < MINES; i++) {
+        int row = random_below(state, CHUNK_HEIGHT);
+        int col = random_below(state, CHUNK_WIDTH);
+        if (chunk[row][col] == 9) {
+            i--;
+        } else {
+            chunk[row][col] = 9;
+        }
+    }
+}
+
+/**
+ * Measures the chunk generation throughput, with the original rejection loop as the reference
+ */
+static void bench_gen_chunk() {
+    uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH];
+    uint64_t safe[CHUNK_HEIGHT];
+    get_safe_tiles(0, 0, CHUNK_HEIGHT / 2, CHUNK_WIDTH / 2, safe);
+    int chunks = 2000000;
+    volatile int sink = 0;
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < chunks; i++) {
+        memset(chunk, 0, sizeof(chunk));
+        uint64_t state = chunk_seed(1, i, 0);
+        reference_mines(chunk, &state);
+        sink += chunk[0][0];
+    }
+    printf("gen_chunk %-14s %8.1f ns/chunk\n", "rejection loop", elapsed(start) * 1e9 / chunks);
+    start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < chunks; i++) {
+        gen_chunk(chunk, 1, i, 0, NULL);
+        sink += chunk[0][0];
+    }
+    printf("gen_chunk %-14s %8.1f ns/chunk\n", "floyd", elapsed(start) * 1e9 / chunks);
+    start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < chunks; i++) {
+        gen_chunk(chunk, 1, i, 0, safe);
+        sink += chunk[0][0];
+    }
+    printf("gen_chunk %-14s %8.1f ns/chunk\n", "floyd, safe", elapsed(start) * 1e9 / chunks);
+}
+
+/**
+ * Measures the restart latency (`R`): the save deleted and a new game started, which generates the
+ * grid around the safe start tiles in one pass and opens the start area. Each restart has a new seed
+ */
+static void bench_restart() {
+    const int radii[] = {1, 4, 7};
+    Game *game = (Game *)malloc(sizeof(Game));
+    for (int k = 0; k < 3; k++) {
+        init_window(game, 2*radii[k] * CHUNK_PX_WIDTH, 2*radii[k] * CHUNK_PX_HEIGHT);
+        int runs = 100;
+        double total = 0, worst = 0;
+        for (int i = 0; i < runs; i++) {
+            srand(i);
+            Uint64 start = SDL_GetPerformanceCounter();
+            delete_save(game);
+            init_game(game);
+            double seconds = elapsed(start);
+            total += seconds;
+            worst = seconds > worst ? seconds : worst;
+        }
+        printf("restart %3dx%-3d grid: mean %7.3f ms, worst %7.3f ms over %d seeds\n", game->map_h, game->map_w, total * 1e3 / runs, worst * 1e3, runs);
+        delete_save(game);
+        free_chunks(game);
+        free(game->pending);
+    }
+    free(game);
+}
+
+/**
+ * Measures the cost of a chunk crossing and the memory of the grid for each loaded chunk radius,
+ * the crossings go back and forth along the rows as a player dragging the view would
+ */
+static void bench_radius() {
+    Game *game = (Game *)malloc(sizeof(Game));
+    for (int radius = 1; radius <= 7; radius++) {
+        init_window(game, 2*radius * CHUNK_PX_WIDTH, 2*radius * CHUNK_PX_HEIGHT);
+        init_game(game);
+        size_t memory = game->size * game->size * (sizeof(Chunk) + sizeof(Chunk *) + MAX_ZERO_COMPONENTS * sizeof(int) + CHUNK_HEIGHT * sizeof(uint64_t))
+            + (game->map_h + 2) * game->pad_stride;
+        int crossings = 200;
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int i = 0; i < crossings; i++) {
+            int dx = (i / 10) % 2 ? -1 : 1;
+            save_game(game);
+            game->cx += dx;
+            shift_game_chunks(game, dx, 0);
+            post_process_shift_chunks(game, dx, 0);
+        }
+        double seconds = elapsed(start);
+        printf("radius %d (%2dx%-2d chunks): crossing %8.3f ms, grid %8.1f KiB\n", radius, game->size, game->size, seconds * 1e3 / crossings, memory / 1024.0);
+        delete_save(game);
+        free_chunks(game);
+        free(game->pending);
+    }
+    free(game);
+}
+
+/**
+ * Measures the frame time of the chunk crossings of a long drag, with the chunks prepared and saved
+ * on the update thread, and with the chunk workers and the chunk cache. A tile is flagged before
+ * each crossing, so the chunks leaving the grid must be saved
+ */
+static void bench_crossing() {
+    const int configs[][2] = {{0, 0}, {CHUNK_WORKERS, CHUNK_CACHE_RINGS}};
+    const int moves[][2] = {{1, 0}, {0, 1}, {-1, 0}, {0, -1}};
+    Game *game = (Game *)malloc(sizeof(Game));
+    for (int k = 0; k < 2; k++) {
+        init_window(game, 1920, 1080);
+        start_workers(game, configs[k][0]);
+        init_chunk_cache(game, configs[k][1]);
+        init_game(game);
+        int crossings = 0;
+        double shift_total = 0, shift_worst = 0, frame_total = 0, frame_worst = 0;
+        for (int leg = 0; leg < 8; leg++) {
+            int dx = moves[leg % 4][0], dy = moves[leg % 4][1];
+            for (int i = 0; i < 25; i++) {
+                int row = game->radius * CHUNK_HEIGHT + i % CHUNK_HEIGHT, col = game->radius * CHUNK_WIDTH + leg % CHUNK_WIDTH;
+                if (get_tile_state(*get_tile(game, row, col)) == HIDDEN) {
+                    set_tile_state(game, row, col, FLAGGED);
+                }
+                SDL_Delay(16); // The frames of the drag between two crossings
+
+                Uint64 start = SDL_GetPerformanceCounter();
+                save_game(game);
+                Uint64 shift_start = SDL_GetPerformanceCounter();
+                game->cx += dx;
+                game->cy += dy;
+                shift_game_chunks(game, dx, dy);
+                post_process_shift_chunks(game, dx, dy);
+                double shift = elapsed(shift_start), frame = elapsed(start);
+                shift_total += shift;
+                frame_total += frame;
+                shift_worst = shift > shift_worst ? shift : shift_worst;
+                frame_worst = frame > frame_worst ? frame : frame_worst;
+                crossings++;
+            }
+        }
+        printf("crossing %dx%d, %d workers, cache of %d rings: shift mean %6.3f ms, worst %6.3f ms; with save_game mean %6.3f ms, worst %6.3f ms\n",
+            game->size, game->size, configs[k][0], configs[k][1], shift_total * 1e3 / crossings, shift_worst * 1e3,
+            frame_total * 1e3 / crossings, frame_worst * 1e3);
+        free_chunk_cache(game);
+        stop_workers(game);
+        delete_save(game);
+        free_chunks(game);
+        free(game->pending);
+    }
+    free(game);
+}
+
+/**
+ * Fills a chunk with bytes depending on its coordinates
+ * \param chunk The chunk to fill
+ * \param row The row of the chunk
+ * \param col The column of the chunk
+ */
+static void fill_chunk(uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH], int row, int col) {
+    for (int i = 0; i < CHUNK_HEIGHT; i++) {
+        for (int j = 0; j < CHUNK_WIDTH; j++) {
+            chunk[i][j] = (uint8_t)(row * 31 + col * 17 + i * 7 + j);
+        }
+    }
+}
+
+/**
+ * Measures the save and load throughput of a world of 100k chunks, with the region files and with
+ * the original file per chunk
+ */
+static void bench_regions() {
+    uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH];
+    int side = 316, chunks = side * side;
+    char filename[50];
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int row = -side / 2; row < side - side / 2; row++) {
+        for (int col = -side / 2; col < side - side / 2; col++) {
+            fill_chunk(chunk, row, col);
+            snprintf(filename, sizeof filename, "saves/%d.%d.msav", row, col);
+            FILE *file = fopen(filename, "wb");
+            fwrite(chunk, 1, sizeof(chunk), file);
+            fclose(file);
+        }
+    }
+    double save = elapsed(start);
+    start = SDL_GetPerformanceCounter();
+    for (int row = -side / 2; row < side - side / 2; row++) {
+        for (int col = -side / 2; col < side - side / 2; col++) {
+            snprintf(filename, sizeof filename, "saves/%d.%d.msav", row, col);
+            FILE *file = fopen(filename, "rb");
+            if (fread(chunk, 1, sizeof(chunk), file) != sizeof(chunk)) {
+                fprintf(stderr, "Error reading file %s\n", filename);
+                exit(1);
+            }
+            fclose(file);
+        }
+    }
+    double load = elapsed(start);
+    printf("%d chunks, file per chunk: save %8.0f chunks/s, load %8.0f chunks/s\n", chunks, chunks / save, chunks / load);
+    for (int row = -side / 2; row < side - side / 2; row++) {
+        for (int col = -side / 2; col < side - side / 2; col++) {
+            snprintf(filename, sizeof filename, "saves/%d.%d.msav", row, col);
+            remove(filename);
+        }
+    }
+
+    start = SDL_GetPerformanceCounter();
+    for (int row = -side / 2; row < side - side / 2; row++) {
+        for (int col = -side / 2; col < side - side / 2; col++) {
+            fill_chunk(chunk, row, col);
+            save_chunk(chunk, row, col);
+        }
+    }
+    save = elapsed(start);
+    close_regions();
+    open_regions();
+    start = SDL_GetPerformanceCounter();
+    for (int row = -side / 2; row < side - side / 2; row++) {
+        for (int col = -side / 2; col < side - side / 2; col++) {
+            if (!load_chunk(chunk, row, col)) {
+                fprintf(stderr, "Error loading chunk %d %d\n", row, col);
+                exit(1);
+            }
+        }
+    }
+    load = elapsed(start);
+    printf("%d chunks, region files:   save %8.0f chunks/s, load %8.0f chunks/s\n", chunks, chunks / save, chunks / load);
+    delete_regions();
+}
+
+/**
+ * Draws a frame of the tiles, as the engine does with `draw`
+ * \param game The game to draw
+ * \return The seconds taken by the frame
+ */
+static double draw_frame(Game *game) {
+    Uint64 start = SDL_GetPerformanceCounter();
+    SDL_RenderClear(_engine->renderer);
+    draw_tiles(game);
+    SDL_RenderPresent(_engine->renderer);
+    return elapsed(start);
+}
+
+/**
+ * Measures the frame time of the tile renderer in a hidden window with the software renderer: with
+ * every visible chunk drawn again, with a tile changed, and while dragging the view. The frames are
+ * drawn again with SSGE objects, which the renderer does not look up anymore
+ * \param atlas_file The path to the tiles atlas
+ */
+static void bench_frames(char *atlas_file) {
+    SDL_SetMainReady();
+    SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+    SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+    SSGE_Init("Minesweeper bench", 1920, 1080, FPS);
+    Game *game = (Game *)malloc(sizeof(Game));
+    init_window(game, 1920, 1080);
+    init_game(game);
+    init_tile_renderer(game, SSGE_LoadTilemap(atlas_file, 6, 6, 0, 4, 4));
+    draw_frame(game);
+
+    const int object_counts[] = {0, 10000};
+    int frames = 200;
+    for (int k = 0; k < 2; k++) {
+        for (int i = 0; i < object_counts[k]; i++) {
+            char name[24];
+            snprintf(name, sizeof name, "object_%d", i);
+            SSGE_CreateObject(name, NULL, 0, 0, SQUARE_SIZE, SQUARE_SIZE, false, NULL, NULL);
+        }
+        double redraw = 0, change = 0, drag = 0;
+        for (int i = 0; i < frames; i++) {
+            reset_render_targets(game, false);
+            redraw += draw_frame(game);
+        }
+        int row = (game->vy + game->win_h / 2) / SQUARE_SIZE, col = (game->vx + game->win_w / 2) / SQUARE_SIZE;
+        for (int i = 0; i < frames; i++) {
+            uint8_t state = get_tile_state(*get_tile(game, row, col));
+            if (state != REVEALED) {
+                set_tile_state(game, row, col, state == FLAGGED ? HIDDEN : FLAGGED);
+            }
+            invalidate_render_rect(game, row, col, row + 1, col + 1);
+            change += draw_frame(game);
+        }
+        for (int i = 0; i < frames; i++) {
+            game->vx += i % 2 ? -1 : 1;
+            drag += draw_frame(game);
+        }
+        printf("frame %dx%d, %5d objects: redraw %7.3f ms, tile changed %7.3f ms, drag %7.3f ms\n", game->win_w, game->win_h, object_counts[k],
+            redraw * 1e3 / frames, change * 1e3 / frames, drag * 1e3 / frames);
+    }
+    SSGE_DestroyAllObjects();
+    free_tile_renderer(game);
+    delete_save(game);
+    free_chunks(game);
+    free(game->pending);
+    free(game);
+    SSGE_Quit();
+}
+
+int main(int argc, char *argv[]) {
+    open_regions();
+    bench_bitplanes();
+    bench_numbers();
+    bench_reveal_area();
+    bench_gen_chunk();
+    bench_restart();
+    bench_radius();
+    bench_crossing();
+    bench_regions();
+    if (argc > 1) {
+        bench_frames(argv[1]);
+    }
+    close_regions();
+    return 0;
+}
@@ -0,0 +1,816 @@
+#include "game.h"
+
+#include <SDL2/SDL_timer.h>
+
+static int failures = 0;
+
+/**
+ * Reports the result of a check
+ * \param ok True if the check passed
+ * \param name The name of the check
+ */
+static void check(bool ok, const char *name) {
+    printf("%s %s\n", ok ? "ok  " : "FAIL", name);
+    if (!ok) {
+        failures++;
+    }
+}
+
+/**
+ * Fills the grid with random mines and states, the other tiles are 0
+ * \param game The game to fill the grid of
+ * \param density The percentage of mines
+ * \param state The state of the generator
+ */
+static void fill_random_grid(Game *game, int density, uint64_t *state) {
+    for (int row = 0; row < game->map_h; row++) {
+        for (int col = 0; col < game->map_w; col++) {
+            uint8_t *tile = get_tile(game, row, col);
+            *tile = (int)random_below(state, 100) < density ? 9 : 0;
+            store_tile_state(tile, (uint8_t)random_below(state, 3));
+        }
+    }
+    build_planes(game);
+}
+
+/**
+ * Computes a tile as the original `gen_numbers` did, with a 3x3 loop over the grid
+ * \param game The game the tile is in
+ * \param row The row of the tile
+ * \param col The column of the tile
+ */
+static uint8_t reference_number(Game *game, int row, int col) {
+    uint8_t tile = *get_tile(game, row, col);
+    if (get_tile_value(tile) == 9) {
+        return tile;
+    }
+    uint8_t count = 0;
+    for (int i = row - 1; i <= row + 1; i++) {
+        for (int j = col - 1; j <= col + 1; j++) {
+            if (in_grid(game, i, j) && get_tile_value(*get_tile(game, i, j)) == 9) {
+                count++;
+            }
+        }
+    }
+    store_tile_value(&tile, count);
+    return tile;
+}
+
+/**
+ * Checks the bitplanes against the tiles: the neighbourhoods read from the planes, and the planes and
+ * flag counts kept by `set_tile_state` over random state changes
+ */
+static void test_bitplanes() {
+    Game *game = (Game *)malloc(sizeof(Game));
+    init_window(game, 1920, 1080);
+    uint64_t state = 2;
+    bool same_neighbourhood = true, same_planes = true, same_flags = true;
+    for (int trial = 0; trial < 50; trial++) {
+        fill_random_grid(game, trial * 2, &state);
+        for (int row = 0; row < game->map_h; row++) {
+            for (int col = 0; col < game->map_w; col++) {
+                for (int plane = 0; plane < PLANE_COUNT; plane++) {
+                    uint16_t expected = 0;
+                    for (int i = -1; i <= 1; i++) {
+                        for (int j = -1; j <= 1; j++) {
+                            if (!in_grid(game, row + i, col + j)) {
+                                continue;
+                            }
+                            uint8_t tile = *get_tile(game, row + i, col + j);
+                            bool set = plane == P_MINE ? get_tile_value(tile) == 9 : get_tile_state(tile) == (plane == P_REVEALED ? REVEALED : FLAGGED);
+                            expected |= (uint16_t)set << ((i + 1)*3 + j + 1);
+                        }
+                    }
+                    same_neighbourhood &= neighbourhood_bits(game, plane, row, col) == expected;
+                }
+            }
+        }
+
+        count_flags_rect(game, 0, 0, game->map_h, game->map_w);
+        for (int i = 0; i < 2000; i++) {
+            set_tile_state(game, random_below(&state, game->map_h), random_below(&state, game->map_w), (uint8_t)random_below(&state, 3));
+        }
+        for (int row = 0; row < game->map_h; row++) {
+            for (int col = 0; col < game->map_w; col++) {
+                uint8_t tile = *get_tile(game, row, col);
+                ChunkPlanes *planes = &get_chunk(game, row / CHUNK_HEIGHT, col / CHUNK_WIDTH)->planes;
+                uint64_t bit = 1ULL << (col % CHUNK_WIDTH);
+                same_planes &= ((planes->bits[P_MINE][row % CHUNK_HEIGHT] & bit) != 0) == (get_tile_value(tile) == 9);
+                same_planes &= ((planes->bits[P_REVEALED][row % CHUNK_HEIGHT] & bit) != 0) == (get_tile_state(tile) == REVEALED);
+                same_planes &= ((planes->bits[P_FLAGGED][row % CHUNK_HEIGHT] & bit) != 0) == (get_tile_state(tile) == FLAGGED);
+                int flags = 0;
+                for (int i = row - 1; i <= row + 1; i++) {
+                    for (int j = col - 1; j <= col + 1; j++) {
+                        flags += (i != row || j != col) && in_grid(game, i, j) && get_tile_state(*get_tile(game, i, j)) == FLAGGED;
+                    }
+                }
+                same_flags &= *get_flag_count(game, row, col) == flags;
+            }
+        }
+    }
+    check(same_neighbourhood, "neighbourhood_bits matches the 3x3 neighbourhood of the tiles");
+    check(same_planes, "set_tile_state keeps the bitplanes in sync with the tiles");
+    check(same_flags, "set_tile_state keeps the flag counts up to date");
+    free_chunks(game);
+    free(game);
+}
+
+/**
+ * Checks `gen_mines` over random safe masks: the number of mines, the safe tiles, the same mines for
+ * the same state, and the frequency of the mines on each tile
+ */
+static void test_gen_mines() {
+    uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH], again[CHUNK_HEIGHT][CHUNK_WIDTH];
+    int frequency[CHUNK_HEIGHT][CHUNK_WIDTH] = {0};
+    uint64_t state = 3;
+    bool count_ok = true, safe_ok = true, same = true;
+    int trials = 20000;
+    for (int trial = 0; trial < trials; trial++) {
+        uint64_t safe[CHUNK_HEIGHT];
+        int allowed = 0;
+        for (int row = 0; row < CHUNK_HEIGHT; row++) {
+            // A quarter of the chunks have no safe tiles, the others up to every tile
+            safe[row] = trial % 4 == 0 ? 0 : next_random(&state) & next_random(&state) & ((1ULL << CHUNK_WIDTH) - 1);
+            allowed += CHUNK_WIDTH - __builtin_popcountll(safe[row]);
+        }
+        uint64_t seed = next_random(&state), gen_state = seed;
+        memset(chunk, 0, sizeof(chunk));
+        gen_mines(chunk, &gen_state, safe);
+        gen_state = seed;
+        memset(again, 0, sizeof(again));
+        gen_mines(again, &gen_state, safe);
+        same &= memcmp(chunk, again, sizeof(chunk)) == 0;
+
+        int mines = 0;
+        for (int row = 0; row < CHUNK_HEIGHT; row++) {
+            for (int col = 0; col < CHUNK_WIDTH; col++) {
+                bool mine = chunk[row][col] == 9;
+                mines += mine;
+                safe_ok &= !(mine && ((safe[row] >> col) & 1)) && (mine || chunk[row][col] == 0);
+                if (trial % 4 == 0) {
+                    frequency[row][col] += mine;
+                }
+            }
+        }
+        count_ok &= mines == (allowed < MINES ? allowed : MINES);
+    }
+    bool uniform = true;
+    double expected = (double)MINES / (CHUNK_HEIGHT * CHUNK_WIDTH);
+    for (int row = 0; row < CHUNK_HEIGHT; row++) {
+        for (int col = 0; col < CHUNK_WIDTH; col++) {
+            uniform &= fabs((double)frequency[row][col] / (trials / 4) - expected) < 0.03;
+        }
+    }
+    check(count_ok, "gen_mines places MINES mines, or every tile left by the safe mask");
+    check(safe_ok, "gen_mines leaves the safe tiles out of the mines");
+    check(same, "gen_mines places the same mines for the same state");
+    check(uniform, "gen_mines places the mines uniformly over the tiles");
+}
+
+/**
+ * Checks every `gen_numbers` kernel the CPU supports against the 3x3 loop, over random grids of
+ * every density
+ */
+static void test_number_kernels() {
+    const char *kernels[] = {"scalar", "sse2", "avx2"};
+    const int windows[][2] = {{WIN_W, WIN_H}, {1920, 1080}};
+    Game *game = (Game *)malloc(sizeof(Game));
+    for (int k = 0; k < 3; k++) {
+        if (!use_number_kernel(kernels[k])) {
+            printf("skip gen_numbers %s kernel, not supported\n", kernels[k]);
+            continue;
+        }
+        bool same = true;
+        uint64_t state = 1;
+        for (int w = 0; w < 2; w++) {
+            init_window(game, windows[w][0], windows[w][1]);
+            uint8_t *expected = (uint8_t *)malloc(game->map_h * game->map_w);
+            for (int trial = 0; trial < (w == 0 ? 5050 : 505) && same; trial++) {
+                fill_random_grid(game, trial % 101, &state);
+                for (int row = 0; row < game->map_h; row++) {
+                    for (int col = 0; col < game->map_w; col++) {
+                        expected[row * game->map_w + col] = reference_number(game, row, col);
+                    }
+                }
+                gen_numbers(game);
+                for (int row = 0; row < game->map_h && same; row++) {
+                    for (int col = 0; col < game->map_w && same; col++) {
+                        same = *get_tile(game, row, col) == expected[row * game->map_w + col];
+                    }
+                }
+            }
+            free(expected);
+            free_chunks(game);
+        }
+        char name[50];
+        snprintf(name, sizeof name, "gen_numbers %s kernel matches the 3x3 loop", kernels[k]);
+        check(same, name);
+    }
+    use_number_kernel(NULL);
+    free(game);
+}
+
+/**
+ * Labels the 8-connected areas of 0 that are not flagged with a flood fill
+ * \param game The game to label the grid of
+ * \param labels The label of each tile (from 1), 0 if the tile is not part of an area
+ * \param by_chunk True to keep the areas inside their chunks, as `build_zero_labels` does
+ */
+static void reference_zero_areas(Game *game, int *labels, bool by_chunk) {
+    int *stack = (int *)malloc(game->map_h * game->map_w * sizeof(int));
+    memset(labels, 0, game->map_h * game->map_w * sizeof(int));
+    int count = 0;
+    for (int start = 0; start < game->map_h * game->map_w; start++) {
+        uint8_t tile = *get_tile(game, start / game->map_w, start % game->map_w);
+        if (labels[start] != 0 || get_tile_value(tile) != 0 || get_tile_state(tile) == FLAGGED) {
+            continue;
+        }
+        int top = 0;
+        stack[top++] = start;
+        labels[start] = ++count;
+        while (top > 0) {
+            int row = stack[--top] / game->map_w, col = stack[top] % game->map_w;
+            for (int i = row - 1; i <= row + 1; i++) {
+                for (int j = col - 1; j <= col + 1; j++) {
+                    if (!in_grid(game, i, j) || labels[i * game->map_w + j] != 0) {
+                        continue;
+                    }
+                    if (by_chunk && (i / CHUNK_HEIGHT != row / CHUNK_HEIGHT || j / CHUNK_WIDTH != col / CHUNK_WIDTH)) {
+                        continue;
+                    }
+                    uint8_t other = *get_tile(game, i, j);
+                    if (get_tile_value(other) == 0 && get_tile_state(other) != FLAGGED) {
+                        labels[i * game->map_w + j] = count;
+                        stack[top++] = i * game->map_w + j;
+                    }
+                }
+            }
+        }
+    }
+    free(stack);
+}
+
+/**
+ * Checks the 0 areas against a flood fill over random grids: the labels of each chunk, and the area
+ * revealed by `reveal_zero_area` once the chunks are stitched
+ */
+static void test_zero_areas() {
+    Game *game = (Game *)malloc(sizeof(Game));
+    init_window(game, WIN_W, WIN_H);
+    game->cx = game->cy = 0;
+    int tiles = game->map_h * game->map_w;
+    int *expected = (int *)malloc(tiles * sizeof(int));
+    int labels = game->size * game->size * MAX_ZERO_COMPONENTS;
+    int *area_label = (int *)malloc((tiles + 1) * sizeof(int));
+    int *label_area = (int *)malloc(labels * sizeof(int));
+    uint8_t *revealed = (uint8_t *)malloc(tiles);
+    uint64_t state = 5;
+    bool same_labels = true, same_area = true;
+    for (int trial = 0; trial < 300; trial++) {
+        fill_random_grid(game, trial % 30, &state);
+        gen_numbers(game);
+        invalidate_zero_components(game, 0, 0, game->map_h, game->map_w);
+        update_zero_components(game);
+
+        // Each chunk label must match a single flood fill area inside the chunk, and the other way
+        reference_zero_areas(game, expected, true);
+        memset(area_label, 0, (tiles + 1) * sizeof(int));
+        memset(label_area, 0, labels * sizeof(int));
+        for (int row = 0; row < game->map_h; row++) {
+            for (int col = 0; col < game->map_w; col++) {
+                Chunk *chunk = get_chunk(game, row / CHUNK_HEIGHT, col / CHUNK_WIDTH);
+                int r = row % CHUNK_HEIGHT, c = col % CHUNK_WIDTH;
+                int label = chunk->zero_labels[r][c], area = expected[row * game->map_w + col];
+                same_labels &= (label != 0) == (area != 0);
+                if (label == 0 || area == 0) {
+                    continue;
+                }
+                same_labels &= label <= chunk->zero_count && ((chunk->zero_rows[label - 1][r] >> c) & 1);
+                int id = (int)(chunk - game->chunk_buffers) * MAX_ZERO_COMPONENTS + label - 1;
+                if (area_label[area] == 0 && label_area[id] == 0) {
+                    area_label[area] = id + 1;
+                    label_area[id] = area;
+                }
+                same_labels &= area_label[area] == id + 1 && label_area[id] == area;
+            }
+        }
+
+        // The area of a random 0 across the seams, grown by the tiles around it
+        reference_zero_areas(game, expected, false);
+        int source = (int)random_below(&state, tiles);
+        while (source < tiles && expected[source] == 0) {
+            source++;
+        }
+        if (source == tiles) {
+            continue;
+        }
+        int count = 0;
+        for (int row = 0; row < game->map_h; row++) {
+            for (int col = 0; col < game->map_w; col++) {
+                uint8_t tile = *get_tile(game, row, col);
+                bool grown = false;
+                for (int i = row - 1; i <= row + 1; i++) {
+                    for (int j = col - 1; j <= col + 1; j++) {
+                        grown |= in_grid(game, i, j) && expected[i * game->map_w + j] == expected[source];
+                    }
+                }
+                grown &= get_tile_state(tile) == HIDDEN;
+                count += grown;
+                revealed[row * game->map_w + col] = grown || get_tile_state(tile) == REVEALED;
+            }
+        }
+        same_area &= reveal_zero_area(game, source / game->map_w, source % game->map_w) == count;
+        for (int i = 0; i < tiles; i++) {
+            same_area &= (get_tile_state(*get_tile(game, i / game->map_w, i % game->map_w)) == REVEALED) == revealed[i];
+        }
+        clear_pending_reveals(game);
+    }
+    check(same_labels, "build_zero_labels matches a flood fill inside each chunk");
+    check(same_area, "reveal_zero_area reveals the flood fill area across the chunks and the tiles around it");
+    free(expected);
+    free(area_label);
+    free(label_area);
+    free(revealed);
+    free_chunks(game);
+    free(game->pending);
+    free(game);
+}
+
+/**
+ * Checks that a pending reveal is only revealed next to a revealed 0 of the grid, kept while the
+ * tiles around it are not all known, and dropped otherwise
+ */
+static void test_pending_reveals() {
+    Game *game = (Game *)malloc(sizeof(Game));
+    init_window(game, WIN_W, WIN_H);
+    init_game(game);
+    for (int row = 0; row < game->map_h; row++) {
+        for (int col = 0; col < game->map_w; col++) {
+            set_tile_state(game, row, col, HIDDEN);
+        }
+    }
+    // A 0 in the grid is revealed alone, the tile next to it continues its area
+    int source_row = -1, source_col = -1;
+    for (int row = 2; row < game->map_h - 2 && source_row == -1; row++) {
+        for (int col = 2; col < game->map_w - 3 && source_row == -1; col++) {
+            if (get_tile_value(*get_tile(game, row, col)) == 0) {
+                source_row = row;
+                source_col = col;
+            }
+        }
+    }
+    set_tile_state(game, source_row, source_col, REVEALED);
+    int far_row = (source_row + game->map_h / 2) % (game->map_h - 4) + 2, far_col = 2;
+    while (get_tile_value(*get_tile(game, far_row, far_col)) == 9) {
+        far_col++;
+    }
+    int edge_row = far_row;
+    while (get_tile_value(*get_tile(game, edge_row, 0)) == 9) {
+        edge_row++;
+    }
+
+    queue_pending_reveal(game, source_row, source_col + 1);
+    queue_pending_reveal(game, far_row, far_col);
+    queue_pending_reveal(game, edge_row, 0);
+    drain_pending_reveals(game);
+    check(get_tile_state(*get_tile(game, source_row, source_col + 1)) == REVEALED, "a pending reveal next to a revealed 0 is revealed");
+    check(get_tile_state(*get_tile(game, far_row, far_col)) == HIDDEN, "a pending reveal without a revealed 0 around it stays hidden");
+    int pending = 0;
+    for (int i = 0; i < game->pending_capacity; i++) {
+        for (int r = 0; r < CHUNK_HEIGHT && game->pending[i].used; r++) {
+            pending += __builtin_popcountll(game->pending[i].rows[r]);
+        }
+    }
+    check(get_tile_state(*get_tile(game, edge_row, 0)) == HIDDEN && pending == 1,
+        "a pending reveal on the edge of the grid is kept until the tiles around it are known");
+    delete_save(game);
+    free_chunks(game);
+    free(game->pending);
+    free(game);
+}
+
+/**
+ * Fills a chunk with bytes depending on its coordinates
+ * \param chunk The chunk to fill
+ * \param row The row of the chunk
+ * \param col The column of the chunk
+ * \param pass Changes the bytes for the same coordinates
+ */
+static void fill_chunk(uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH], int row, int col, int pass) {
+    for (int i = 0; i < CHUNK_HEIGHT; i++) {
+        for (int j = 0; j < CHUNK_WIDTH; j++) {
+            chunk[i][j] = (uint8_t)(row * 31 + col * 17 + i * 7 + j + pass * 101);
+        }
+    }
+}
+
+/**
+ * Gets the number of files in `saves` and their total size
+ * \param bytes The variable to store the total size in
+ * \return The number of files
+ */
+static int save_files(long *bytes) {
+    int count = 0;
+    *bytes = 0;
+    DIR *dir = opendir("saves");
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        char filename[300];
+        snprintf(filename, sizeof filename, "saves/%s", entry->d_name);
+        FILE *file = fopen(filename, "rb");
+        fseek(file, 0, SEEK_END);
+        *bytes += ftell(file);
+        fclose(file);
+        count++;
+    }
+    closedir(dir);
+    return count;
+}
+
+/**
+ * Gets the tiles queued as pending reveals in a chunk
+ * \param game The game the pending reveals are in
+ * \param crow The row of the chunk
+ * \param ccol The column of the chunk
+ * \param rows The variable to store the tiles in, laid out as the bitplanes
+ */
+static void pending_rows(Game *game, int crow, int ccol, uint64_t rows[CHUNK_HEIGHT]) {
+    memset(rows, 0, CHUNK_HEIGHT * sizeof(uint64_t));
+    for (int i = 0; i < game->pending_capacity; i++) {
+        if (game->pending[i].used && game->pending[i].crow == crow && game->pending[i].ccol == ccol) {
+            memcpy(rows, game->pending[i].rows, CHUNK_HEIGHT * sizeof(uint64_t));
+        }
+    }
+}
+
+/**
+ * Checks the pending reveals files: the tiles queued in many chunks are read back from them, the
+ * files of the chunks drained are deleted, and the single file of the older saves is moved to them
+ */
+static void test_pending_files() {
+    Game *game = (Game *)malloc(sizeof(Game));
+    init_window(game, WIN_W, WIN_H);
+    game->cx = game->cy = 0;
+    uint64_t state = 4;
+    for (int i = 0; i < 5000; i++) {
+        queue_pending_reveal(game, (int)random_below(&state, 2000) - 1000, (int)random_below(&state, 2000) - 1000);
+    }
+    int chunks = game->pending_count;
+    PendingReveal *expected = (PendingReveal *)malloc(game->pending_capacity * sizeof(PendingReveal));
+    memcpy(expected, game->pending, game->pending_capacity * sizeof(PendingReveal));
+    int capacity = game->pending_capacity;
+    save_pending_reveals(game);
+    load_pending_reveals(game);
+    bool same = game->pending_count == chunks;
+    for (int i = 0; i < capacity; i++) {
+        uint64_t rows[CHUNK_HEIGHT];
+        if (expected[i].used) {
+            pending_rows(game, expected[i].crow, expected[i].ccol, rows);
+            same &= memcmp(rows, expected[i].rows, sizeof(rows)) == 0;
+        }
+    }
+    check(same, "load_pending_reveals reads back the saved pending reveals");
+
+    // Drains every chunk by centering the grid on it, the cleared grid has no revealed 0
+    for (int cy = -1000 / CHUNK_HEIGHT - 2; cy <= 1000 / CHUNK_HEIGHT + 2; cy++) {
+        for (int cx = -1000 / CHUNK_WIDTH - 2; cx <= 1000 / CHUNK_WIDTH + 2; cx++) {
+            game->cy = cy;
+            game->cx = cx;
+            drain_pending_reveals(game);
+        }
+    }
+    save_pending_reveals(game);
+    long unused;
+    int files = save_files(&unused);
+    load_pending_reveals(game);
+    int left = 0;
+    for (int i = 0; i < game->pending_capacity; i++) {
+        for (int r = 0; r < CHUNK_HEIGHT && game->pending[i].used; r++) {
+            left += __builtin_popcountll(game->pending[i].rows[r]);
+        }
+    }
+    check(files == 0 && left == 0, "save_pending_reveals deletes the files of the drained chunks");
+
+    FILE *file = fopen("saves/pending.msav", "wb");
+    int count = 2;
+    fwrite(&count, sizeof(int), 1, file);
+    for (int i = 0; i < count; i++) {
+        int crow = -40 + i * 80, ccol = 7;
+        uint64_t rows[CHUNK_HEIGHT] = {0};
+        rows[i] = 1ULL << 3;
+        fwrite(&crow, sizeof(int), 1, file);
+        fwrite(&ccol, sizeof(int), 1, file);
+        fwrite(rows, sizeof(uint64_t), CHUNK_HEIGHT, file);
+    }
+    fclose(file);
+    load_pending_reveals(game);
+    load_pending_reveals(game);
+    uint64_t first[CHUNK_HEIGHT], second[CHUNK_HEIGHT];
+    pending_rows(game, -40, 7, first);
+    pending_rows(game, 40, 7, second);
+    check(first[0] == 1ULL << 3 && second[1] == 1ULL << 3 && !file_exists("saves/pending.msav") && save_files(&unused) == 2,
+        "load_pending_reveals moves saves/pending.msav to the pending reveals files");
+
+    file = fopen("saves/p.0.0.msav", "wb");
+    count = 1000000;
+    fwrite(&count, sizeof(int), 1, file);
+    fclose(file);
+    load_pending_reveals(game);
+    check(game->pending_count == 2, "load_pending_reveals reads a truncated file as no pending reveals");
+
+    delete_save(game);
+    free(expected);
+    free_chunks(game);
+    free(game->pending);
+    free(game);
+}
+
+/**
+ * Loads the chunks of an area and compares them to `fill_chunk`
+ * \return True if every chunk was loaded with the bytes of the pass
+ */
+static bool load_area(int row0, int col0, int row1, int col1, int pass) {
+    uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH], expected[CHUNK_HEIGHT][CHUNK_WIDTH];
+    bool same = true;
+    for (int row = row0; row < row1; row++) {
+        for (int col = col0; col < col1; col++) {
+            fill_chunk(expected, row, col, pass);
+            same &= load_chunk(chunk, row, col) && memcmp(chunk, expected, sizeof(chunk)) == 0;
+        }
+    }
+    return same;
+}
+
+/**
+ * Checks the region files: chunks saved on both sides of 0 and over more regions than open handles,
+ * rewritten in place, read back after the files are closed, the chunks never saved, and the move of
+ * the chunks saved one file per chunk
+ */
+static void test_regions() {
+    uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH], expected[CHUNK_HEIGHT][CHUNK_WIDTH];
+    int row0 = -40, col0 = -70, row1 = 40, col1 = 70;
+    for (int pass = 0; pass < 2; pass++) {
+        for (int row = row0; row < row1; row++) {
+            for (int col = col0; col < col1; col++) {
+                fill_chunk(chunk, row, col, pass);
+                save_chunk(chunk, row, col);
+            }
+        }
+        if (pass == 0) {
+            check(load_area(row0, col0, row1, col1, 0), "load_chunk reads back the saved chunks");
+        }
+    }
+    long bytes;
+    int files = save_files(&bytes);
+    // 4x6 regions of 32x32 chunks, each file is its slot table and a slot per chunk
+    check(files == 24 && bytes == files * (32 * 32 * 4) + (row1 - row0) * (col1 - col0) * CHUNK_HEIGHT * CHUNK_WIDTH,
+        "save_chunk rewrites the saved chunks in place");
+    close_regions();
+    open_regions();
+    check(load_area(row0, col0, row1, col1, 1), "load_chunk reads the rewritten chunks from the region files");
+
+    bool unsaved = true;
+    const int unsaved_chunks[][2] = {{row1, 0}, {0, col0 - 1}, {1000, -5000}, {-5000, 1000}};
+    for (int i = 0; i < 4; i++) {
+        fill_chunk(chunk, 0, 0, 2);
+        memcpy(expected, chunk, sizeof(chunk));
+        unsaved &= !load_chunk(chunk, unsaved_chunks[i][0], unsaved_chunks[i][1]) && memcmp(chunk, expected, sizeof(chunk)) == 0;
+    }
+    long unused;
+    check(unsaved && save_files(&unused) == files, "load_chunk leaves the chunks never saved as they are");
+    delete_regions();
+
+    for (int row = -3; row < 3; row++) {
+        for (int col = -3; col < 3; col++) {
+            char filename[50];
+            snprintf(filename, sizeof filename, "saves/%d.%d.msav", row * 20, col * 20);
+            FILE *file = fopen(filename, "wb");
+            fill_chunk(chunk, row * 20, col * 20, 3);
+            fwrite(chunk, 1, row == 2 && col == 2 ? 10 : sizeof(chunk), file); // The last one is truncated, alone in its region
+            fclose(file);
+        }
+    }
+    migrate_chunk_files();
+    bool migrated = true;
+    for (int row = -3; row < 3; row++) {
+        for (int col = -3; col < 3; col++) {
+            fill_chunk(expected, row * 20, col * 20, 3);
+            bool loaded = load_chunk(chunk, row * 20, col * 20);
+            migrated &= row == 2 && col == 2 ? !loaded : loaded && memcmp(chunk, expected, sizeof(chunk)) == 0;
+        }
+    }
+    // 16 regions hold the chunks, the one of the truncated chunk is not created
+    check(migrated && save_files(&unused) == 15, "migrate_chunk_files moves the complete chunk files to the region files");
+    delete_regions();
+    check(save_files(&unused) == 0, "delete_regions deletes the region files");
+}
+
+/**
+ * Takes a chunk from the ready cache, queues the ring again until a worker prepared it
+ * \return True if the chunk was taken within a few seconds
+ */
+static bool wait_ready_chunk(Game *game, int crow, int ccol, uint8_t tiles[CHUNK_HEIGHT][CHUNK_WIDTH], bool *stored) {
+    for (int i = 0; i < 5000; i++) {
+        if (take_ready_chunk(game, crow, ccol, tiles, stored)) {
+            return true;
+        }
+        SDL_Delay(1);
+        prefetch_chunks(game);
+    }
+    return false;
+}
+
+/**
+ * Checks the chunk workers: the ring around the grid is generated or loaded like on the update
+ * thread, a chunk with a queued write is prepared from it, and the queued writes reach the files
+ */
+static void test_workers() {
+    Game *game = (Game *)malloc(sizeof(Game));
+    init_window(game, WIN_W, WIN_H);
+    game->cx = game->cy = 0;
+    game->seed = 6;
+    start_workers(game, 2);
+    int radius = game->radius + 1;
+    uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH], expected[CHUNK_HEIGHT][CHUNK_WIDTH];
+    fill_chunk(chunk, -radius, 0, 0);
+    save_chunk(chunk, -radius, 0);
+    fill_chunk(chunk, radius, 0, 0);
+    queue_chunk_save(game, chunk, radius, 0);
+
+    prefetch_chunks(game);
+    bool same = true, queued = true;
+    for (int drow = -radius; drow <= radius; drow++) {
+        for (int dcol = -radius; dcol <= radius; dcol++) {
+            if (abs(drow) != radius && abs(dcol) != radius) {
+                continue;
+            }
+            bool stored = false, saved = dcol == 0 && abs(drow) == radius;
+            if (saved) {
+                fill_chunk(expected, drow, dcol, 0);
+            } else {
+                gen_chunk(expected, game->seed, drow, dcol, NULL);
+            }
+            bool ready = wait_ready_chunk(game, drow, dcol, chunk, &stored) && memcmp(chunk, expected, sizeof(chunk)) == 0 && stored == saved;
+            if (drow == radius && dcol == 0) {
+                queued = ready;
+            } else {
+                same &= ready;
+            }
+        }
+    }
+    check(same, "take_ready_chunk returns the ring generated or loaded by the workers");
+    check(queued, "take_ready_chunk returns a chunk with a queued write as it was queued");
+
+    for (int pass = 1; pass < 4; pass++) {
+        for (int col = 0; col < 50; col++) {
+            fill_chunk(chunk, 100, col, pass);
+            queue_chunk_save(game, chunk, 100, col);
+        }
+    }
+    flush_chunk_writes(game);
+    check(load_area(100, 0, 101, 50, 3) && game->write_volume == (1 + 150) * CHUNK_HEIGHT * CHUNK_WIDTH,
+        "flush_chunk_writes waits for the latest write of every queued chunk");
+    stop_workers(game);
+    delete_regions();
+    free_chunks(game);
+    free(game);
+}
+
+/**
+ * Checks the chunk cache: the chunks stay in memory until it is full, the least recently used one is
+ * evicted and written back, only the changed chunks are written, and the hits and misses are counted
+ */
+static void test_chunk_cache() {
+    Game *game = (Game *)malloc(sizeof(Game));
+    init_window(game, WIN_W, WIN_H);
+    init_chunk_cache(game, 1);
+    int capacity = 4 * game->size + 4; // A ring around the grid
+    uint8_t chunk[CHUNK_HEIGHT][CHUNK_WIDTH], expected[CHUNK_HEIGHT][CHUNK_WIDTH];
+    bool kept = true;
+    for (int col = 0; col < capacity; col++) {
+        fill_chunk(chunk, 300, col, 0);
+        cache_chunk(game, chunk, 300, col);
+    }
+    for (int col = 0; col < capacity; col++) {
+        kept &= chunk_cached(game, 300, col) && !load_chunk(chunk, 300, col);
+    }
+    check(kept, "cache_chunk keeps the chunks in memory until the cache is full");
+
+    // The first chunk is read, the second one becomes the least recently used
+    fill_chunk(expected, 300, 0, 0);
+    bool hit = read_cached_chunk(game, chunk, 300, 0) && memcmp(chunk, expected, sizeof(chunk)) == 0;
+    fill_chunk(chunk, 300, capacity, 0);
+    cache_chunk(game, chunk, 300, capacity);
+    bool evicted = chunk_cached(game, 300, 0) && !chunk_cached(game, 300, 1) && load_area(300, 1, 301, 2, 0);
+    bool miss = !read_cached_chunk(game, chunk, 300, 1);
+    uint32_t hits, misses;
+    get_chunk_cache_stats(game, &hits, &misses);
+    check(hit && evicted, "cache_chunk evicts the least recently used chunk and writes it back");
+    check(miss && hits == 1 && misses == 1, "read_cached_chunk counts the hits and misses");
+
+    write_back_chunks(game);
+    uint64_t volume = game->write_volume;
+    fill_chunk(chunk, 300, 2, 0);
+    cache_chunk(game, chunk, 300, 2);
+    fill_chunk(chunk, 300, 3, 1);
+    cache_chunk(game, chunk, 300, 3);
+    for (int col = capacity + 1; col <= 2 * capacity; col++) {
+        fill_chunk(chunk, 300, col, 0);
+        cache_chunk(game, chunk, 300, col);
+    }
+    check(game->write_volume == volume + CHUNK_HEIGHT * CHUNK_WIDTH && load_area(300, 2, 301, 3, 0) && load_area(300, 3, 301, 4, 1),
+        "an evicted chunk is only written back if it changed since it was written");
+    free_chunk_cache(game);
+    delete_regions();
+    free_chunks(game);
+    free(game);
+}
+
+/**
+ * Checks which chunks are saved: the untouched chunks are generated again, a chunk is saved for its
+ * flags, its revealed tiles or a border mine next to a revealed tile, and a stored chunk is only
+ * saved again once it changed
+ */
+static void test_chunk_saves() {
+    Game *game = (Game *)malloc(sizeof(Game));
+    init_window(game, WIN_W, WIN_H);
+    init_game(game);
+    int size = game->size;
+    for (int row = 0; row < game->map_h; row++) {
+        for (int col = 0; col < game->map_w; col++) {
+            set_tile_state(game, row, col, HIDDEN);
+        }
+    }
+    for (int i = 0; i < size * size; i++) {
+        game->chunks[i]->stored = game->chunks[i]->unsaved = false;
+    }
+    bool untouched = true;
+    for (int crow = 0; crow < size; crow++) {
+        for (int ccol = 0; ccol < size; ccol++) {
+            untouched &= !chunk_needs_save(game, crow, ccol);
+        }
+    }
+    check(untouched, "chunk_needs_save skips the chunks generated again from the seed");
+
+    // A flag in the first chunk, and a tile revealed next to a mine on the left border of a chunk of
+    // the last column, away from its corners
+    int mine_crow = 1, mine_row = CHUNK_HEIGHT + CHUNK_HEIGHT / 2, col = (size - 1) * CHUNK_WIDTH;
+    store_tile_value(get_tile(game, mine_row, col), 9);
+    store_tile_value(get_tile(game, mine_row, col - 1), 1);
+    build_planes(game);
+    set_tile_state(game, 0, 0, FLAGGED);
+    set_tile_state(game, mine_row, col - 1, REVEALED);
+    bool needed = true;
+    int expected = 0;
+    for (int crow = 0; crow < size; crow++) {
+        for (int ccol = 0; ccol < size; ccol++) {
+            bool saved = (crow == 0 && ccol == 0) || (crow == mine_crow && ccol >= size - 2);
+            needed &= chunk_needs_save(game, crow, ccol) == saved;
+            expected += saved;
+        }
+    }
+    check(needed, "chunk_needs_save keeps the flags, the revealed tiles and the border mines next to them");
+
+    uint64_t volume = game->write_volume;
+    save_chunks(game);
+    bool stored = true;
+    for (int i = 0; i < size * size; i++) {
+        stored &= !game->chunks[i]->unsaved;
+    }
+    check(stored && game->write_volume == volume + expected * CHUNK_HEIGHT * CHUNK_WIDTH, "save_chunks writes the chunks that must be saved");
+    volume = game->write_volume;
+    save_chunks(game);
+    check(game->write_volume == volume, "save_chunks skips the stored chunks that did not change");
+
+    set_tile_state(game, mine_row, col - 1, FLAGGED);
+    Chunk *chunk = get_chunk(game, mine_crow, size - 2);
+    bool changed = chunk->unsaved;
+    save_chunks(game);
+    uint8_t tiles[CHUNK_HEIGHT][CHUNK_WIDTH];
+    changed &= load_chunk(tiles, mine_crow + game->cy - game->radius, size - 2 + game->cx - game->radius) && memcmp(tiles, chunk->tiles, sizeof(tiles)) == 0;
+    check(changed && game->write_volume == volume + CHUNK_HEIGHT * CHUNK_WIDTH, "set_tile_state marks its chunk to be saved again");
+    delete_save(game);
+    free_chunks(game);
+    free(game->pending);
+    free(game);
+}
+
+int main(int argc, char *argv[]) {
+    open_regions();
+    test_bitplanes();
+    test_gen_mines();
+    test_number_kernels();
+    test_zero_areas();
+    test_pending_reveals();
+    test_pending_files();
+    test_regions();
+    test_workers();
+    test_chunk_cache();
+    test_chunk_saves();
+    close_regions();
+    printf("%d failure(s)\n", failures);
+    return failures > 0;
+}